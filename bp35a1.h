@@ -1,202 +1,545 @@
 #ifndef BP35A1_H_
 #define BP35A1_H_
 
-#include "Arduino.h"
-#include "HardwareSerial.h"
+#include "bp35a1_Platform.h"
 
+#include "bp35a1_ConnectionStore.h"
+#include "bp35a1_EchonetFrame.h"
+#include "bp35a1_Hex.h"
+#include "bp35a1_LineBuffer.h"
+#include "bp35a1_MeterSnapshot.h"
+#include "bp35a1_PollPlan.h"
+#include "bp35a1_PropertyMap.h"
+#include "bp35a1_PropertyCache.h"
+#include "bp35a1_PropertyRegistry.h"
+#include "bp35a1_Result.h"
+#include "bp35a1_RetryPolicy.h"
+#include "bp35a1_Seqlock.h"
+#include "bp35a1_SerialPort.h"
 #include "bp35a1_UDP_Response.h"
 
 #include <iomanip>
 #include <sstream>
+#include <algorithm>
 #include <array>
+#include <functional>
 #include <vector>
 
+// 同時に応答待ちにできる ECHONET Lite 要求の数
+#ifndef BP35A1_MAX_TRANSACTIONS
+#define BP35A1_MAX_TRANSACTIONS 4
+#endif
+
+// 送信する ECHONET Lite フレームの最大長(バイト)
+#ifndef BP35A1_MAX_REQUEST_SIZE
+#define BP35A1_MAX_REQUEST_SIZE 64
+#endif
+
 enum class ResponseType : int
 {
+  SET_SNA = 0x51, // SetC_SNA 書き込みできないプロパティの PDC が 0 以外で返る
+  GET_SNA = 0x52, // Get_SNA 読み出せないプロパティの PDC が 0 で返る
   SET = 0x71,
-  GET = 0x72
+  GET = 0x72,
+  INF = 0x73, // プロパティ値通知(定時積算電力量など)
+  INFC = 0x74 // プロパティ値通知(応答要)。INFC_Res(0x7A)を返す
+};
+
+enum class CommandStatus : byte
+{
+  IDLE,      // コマンド未実行
+  BUSY,      // コマンド実行中
+  SUCCEEDED, // コマンド成功
+  FAILED     // コマンド失敗
 };
 
-enum class CmdType : byte
+// ERXUDP のデータ部の形式(WOPT の設定)
+enum class ErxudpFormat : byte
 {
-  B_ROUTE_ID = 0xC0,                    // Bルート識別番号
-  ONE_MINUTE_TOTAL_POWER = 0xD0,        // 1分積算電力量計測値(正逆)
-  COEFFICIENT = 0xD3,                   // 積算電力量係数を取得する
-  EFFECTIVE_DIGITS = 0xD7,              // 積算電力量有効桁数
-  TOTAL_POWER = 0xE0,                   // 積算電力量計測値(kWh)を取得する
-  POWER_UNIT = 0xE1,                    // 積算電力量単位を取得する
-  TOTAL_POWER_HISTORIES = 0xE2,         // 積算電力量計測値履歴(kWh)を取得する
-  TOTAL_POWER_REVERSE = 0xE3,           // 積算電力量計測値(逆方向)を取得する
-  TOTAL_POWER_HISTORIES_REVERSE = 0xE4, // 積算電力量計測値履歴(逆方向)を取得する
-  TOTAL_HISTORY_COLLECTION_DATE = 0xE5, // 積算履歴収集日を取得/変更する
-  INSTANTANEOUS_POWER = 0xE7,           // 瞬時電力計測値(W)を取得する
-  INSTANTANEOUS_AMPERAGE = 0xE8,        // 瞬時電流計測値(0.1A)を取得する
-  CURRENT_TOTAL_POWER = 0xEA,           // 30分毎の積算電力量計測値(kWh)を取得する
-  CURRENT_TOTAL_POWER_REVERSE = 0xEB,   // 30分毎の積算電力量計測値(逆方向)を取得する
-  TOTAL_POWER_HISTORIES3 = 0xEE,        // 積算電力量計測値履歴3(正逆,1分)
-  TOTAL_HISTORY_COLLECTION_DATE3 = 0xEF // 積算履歴収集日3を取得/変更する
+  ASCII,  // 16 進文字列(WOPT 01)
+  BINARY  // バイナリ(WOPT 00)。UART の転送量が半分になる
 };
 
-struct ScanResult
+// 非同期要求の結果
+struct AsyncResult
 {
-  String channel;
-  String panId;
-  String addr;
+  uint16_t tid;
+  CommandStatus status;
+  unsigned long latency; // 要求してから完了するまでの時間(ms)。再送を含む
+  ErrorCategory error;   // 失敗した原因
+  byte retries;          // 再送した回数
+  byte event21Status;    // 最後に受信した EVENT 21 のステータス
 };
 
-class BP35A1
+// BP35A1 本体。シリアルと時計はテンプレート引数で与え、コンパイル時に解決する
+// Transport: available() / read() / readBytes() / write() / print() / printf() を持つシリアル
+//            (HardwareSerial、SerialPort の派生クラスなど)。waitForData() があれば受信待ちに使う
+// Clock: 経過時間(ms)を返す now() と、待機する sleep() を持つ時計
+template <typename Transport, typename Clock = MillisClock>
+class BasicBP35A1
 {
 public:
-  BP35A1();
-  BP35A1(HardwareSerial *serial);
+  BasicBP35A1() {}
+  explicit BasicBP35A1(Transport *serial, ErxudpFormat format = ErxudpFormat::ASCII);
+
+  typedef std::function<void(CommandStatus status)> CompletionCallback;
+  typedef std::function<void(uint16_t tid, CommandStatus status)> TransactionCallback;
+
+  // ノンブロッキング API
+  // start*() でコマンドを開始し、poll() を呼び出すたびに受信データでコマンドの状態を進める
+  void poll();                                                    // 受信データを処理し、実行中のコマンドを進める
+  CommandStatus getCommandStatus() const { return _commandStatus; } // 最後に開始したコマンドの状態
+  const CommandResult &getCommandResult() const { return _commandResult; } // 最後に完了したコマンドの結果
+  bool isBusy() const { return _commandStatus == CommandStatus::BUSY; }
+  void setCompletionCallback(CompletionCallback callback) { _completionCallback = callback; } // コマンド完了時に呼び出される
+
+  bool startGetVersion();
+  bool startGetAsciiMode();
+  bool startGetErxudpFormat(); // ROPT。コンストラクタで指定した形式なら成功
+  bool startSetErxudpFormat(); // WOPT。コンストラクタで指定した形式に書き換える
+  bool startSetPassword(const char *pass);
+  bool startSetId(const char *id);
+  bool startScanChannel(uint32_t channelMask = SCAN_ALL_CHANNELS, int duration = SCAN_MIN_DURATION);
+  bool startGetIpv6Address();
+  bool startSetChannel();
+  bool startSetPanId();
+  bool startSetSessionLifetime(unsigned int seconds);
+  bool startConnection();
+  bool startReauthentication(); // SKREJOIN
+
+  // プロパティ要求は TID ごとに管理され、応答を待たずに続けて発行できる
+  // 戻り値は要求の TID。要求を受け付けられなかった場合は 0
+  uint16_t startGetProperties(std::vector<CmdType> commands);
+  uint16_t startSetProperties(CmdType command, std::vector<byte> values);
+  CommandStatus getTransactionStatus(uint16_t tid) const; // 要求の状態。古すぎて記録にない TID は IDLE
+  CommandResult getTransactionResult(uint16_t tid) const; // 完了した要求の結果。実行中なら BUSY、記録にない TID は INVALID_ARGUMENT
+  void setRetryPolicy(const RetryPolicy &policy) { _retryPolicy = policy; } // 以降の再送に使う
+  const RetryPolicy &getRetryPolicy() const { return _retryPolicy; }
+  size_t getPendingTransactionCount() const;              // 送信待ち・応答待ちの要求の数
+  void setTransactionCallback(TransactionCallback callback) { _transactionCallback = callback; } // 要求完了時に呼び出される
+
+  // 非同期 API
+  // 要求を発行してすぐに戻り、完了すると poll() の中でコールバックが呼び出される
+  // 戻り値は要求の TID。0 の場合は要求を受け付けられず、コールバックは呼び出されない
+  typedef std::function<void(const AsyncResult &result)> AsyncCallback;
+  template <typename T>
+  using ValueCallback = std::function<void(const AsyncResult &result, T value)>; // 失敗した場合の value は前回の値
+  uint16_t getPropertiesAsync(std::vector<CmdType> commands, AsyncCallback callback);
+  uint16_t setPropertiesAsync(CmdType command, std::vector<byte> values, AsyncCallback callback);
+  uint16_t requestCoefficientAsync(ValueCallback<int> callback); // 0xD3
+  uint16_t requestPowerUnitAsync(ValueCallback<float> callback); // 0xE1
+#ifndef BP35A1_DISABLE_EPC_E0
+  uint16_t requestTotalPowerAsync(ValueCallback<float> callback); // 0xE0(kWh)
+#endif
+#ifndef BP35A1_DISABLE_EPC_E5
+  uint16_t requestTotalHistoryCollectionDateAsync(ValueCallback<byte> callback); // 0xE5
+#endif
+#ifndef BP35A1_DISABLE_EPC_E7
+  uint16_t requestInstantaneousPowerAsync(ValueCallback<int> callback); // 0xE7(W)
+#endif
+#ifndef BP35A1_DISABLE_EPC_E8
+  uint16_t requestInstantaneousAmperageAsync(ValueCallback<InstantaneousAmperage> callback); // 0xE8
+#endif
+#ifndef BP35A1_DISABLE_EPC_EA
+  uint16_t requestCurrentTotalPowerAsync(ValueCallback<float> callback); // 0xEA(kWh)
+#endif
+#ifndef BP35A1_DISABLE_EPC_D7
+  uint16_t requestEffectiveDigitsAsync(ValueCallback<byte> callback); // 0xD7
+#endif
+#ifndef BP35A1_DISABLE_EPC_E3
+  uint16_t requestReverseTotalPowerAsync(ValueCallback<long> callback); // 0xE3
+#endif
+
+  // 取得済みの値は受信した時刻とプロパティごとの有効期間(TTL)を持つ
+  // fetch*() は有効期間内の値があれば送信せずに成功し、同じプロパティを取得中なら新しく送らずにその要求の完了を待つ
+  bool fetchProperty(CmdType command);
+  CommandResult tryFetchProperty(CmdType command);
+  bool fetchPropertyAsync(CmdType command, AsyncCallback callback); // 有効期間内ならその場で TID 0 の結果でコールバックを呼ぶ。false なら呼ばない
+  void setPropertyTtl(CmdType command, unsigned long ttl) { _propertyCache.setTtl(command, ttl); } // ms。0 なら常に取得し直す
+  bool isPropertyFresh(CmdType command) const { return _propertyCache.isFresh(command, Clock::now()); }
+  unsigned long getPropertyAge(CmdType command) const { return _propertyCache.getAge(command, Clock::now()); } // ms。未受信なら PropertyCache::NO_DATA
+  void invalidateProperty(CmdType command) { _propertyCache.invalidate(command); }
+  const PropertyCache &getPropertyCache() const { return _propertyCache; }
+
+  // 不可応答(Get_SNA / SetC_SNA)で拒否されたプロパティ。以降の要求からは除かれ、再送もしない
+  bool isGetRejected(CmdType command) const { return _getRejected.contains(static_cast<byte>(command)); }
+  bool isSetRejected(CmdType command) const { return _setRejected.contains(static_cast<byte>(command)); }
+  void clearRejectedProperties(); // メーターを交換した場合などに拒否の記録を消す
+
+  // プロパティマップ(0x9D / 0x9E / 0x9F)を取得すると、メーターが実装していないプロパティは要求せずに失敗にする
+  bool discoverProperties();
+  uint16_t startDiscoverProperties();
+  const PropertyMapCache &getPropertyMaps() const { return _propertyMaps; }
+  size_t exportPropertyMaps(byte *out, size_t size) const { return _propertyMaps.exportTo(out, size); } // PropertyMapCache::EXPORT_SIZE バイト必要
+  bool importPropertyMaps(const byte *data, size_t size) { return _propertyMaps.importFrom(data, size); }
+  bool isGetSupported(CmdType command) const; // 拒否されておらず、Get プロパティマップに含まれる(未取得なら true)
+  bool isSetSupported(CmdType command) const; // 拒否されておらず、Set プロパティマップに含まれる(未取得なら true)
+
+  // 定期取得 API
+  // 登録したプロパティは poll() の中で期限が来たものから 1 つの Get 要求にまとめて取得される
+  typedef PollPlan::PropertyCallback PollCallback;
+  bool addPollProperty(CmdType command, unsigned long interval); // interval(ms) ごとに取得する
+  bool removePollProperty(CmdType command);
+  void clearPollPlan();
+  void setPollCallback(PollCallback callback) { _pollCallback = callback; } // 取得したプロパティごとに呼び出される
+
+  // メーターからの通知(INF / INFC)。要求とは関係なく届き、通常の応答と同じように値が保存される
+  // INFC には INFC_Res を自動で返す
+  typedef PollPlan::PropertyCallback NotificationCallback;
+  void setNotificationCallback(NotificationCallback callback) { _notificationCallback = callback; } // 通知されたプロパティごとに呼び出される
 
   void setEchoCallback(bool isEnable); // コマンドエコーバックを変更する
   void deleteSession();                // 以前のPANAセッションを解除する
   bool getVersion();                   // バージョン情報を取得する
   bool getAsciiMode();                 // BP35A1のASCII出力モードを確認する
   bool assureAsciiMode();
+  bool assureErxudpFormat();           // BP35A1の出力モードをコンストラクタで指定した形式に合わせる
 
   bool setPassword(const char *pass); // B ルートの PASSWORD を設定する
   bool setId(const char *id);         // B ルートの ID を設定する
 
-  bool scanChannel(); // チャンネルスキャンを実行する
+  // チャンネルスキャンを実行する。見つからなければ duration を 1 ずつ上げて SCAN_MAX_DURATION まで繰り返す
+  // 見つかった PAN のうち、Pairing ID が B ルート ID と一致するものを優先し、LQI が最も高いものを選ぶ
+  bool scanChannel(uint32_t channelMask = SCAN_ALL_CHANNELS, int duration = SCAN_MIN_DURATION);
+  static uint32_t getChannelMask(const char *channel); // チャンネル(例: "21")だけをスキャンするマスク。不正なら 0
 
   bool getIpv6Address();           // MAC アドレスを IPv6 アドレスに変換
   bool setChannel();               // チャンネルを設定する
   bool setPanId();                 // PAN ID を設定する
   bool setSessionLifetime(unsigned int seconds); // PANAセッション有効期限を設定する
   bool requestAndWaitConnection(); // PANA 接続要求を送信し、接続完了を待つ
+  bool reauthenticate();           // PANA 再認証を行い、完了を待つ
+
+  // PANA セッション有効期限の percent % が過ぎたら、送信中の要求がない合間に poll() の中で再認証する
+  // 再認証が終わるまで新しい要求は送らずに待たせる。0 で無効(モジュールに任せる)
+  void setReauthThreshold(byte percent) { _reauthThreshold = percent; }
+  bool isAuthenticated() const { return _isAuthenticated; }
+
+  // 接続できた PAN の情報を保存しておき、次回はスキャンを省いて接続する(ウォームスタート)
+  bool connect(const char *id, const char *password, ConnectionStore *store = nullptr); // 保存した情報で接続できなければスキャンする
+  bool restoreConnection(ConnectionStore *store);     // 保存した PAN に SKSCAN / SKLL64 なしで接続する
+  bool saveConnection(ConnectionStore *store) const;  // 接続中の PAN の情報を保存する
+  ConnectionInfo getConnectionInfo() const;
   bool readReCertificationEvent(); // 再認証イベントを読み取る
 
   bool getProperties(std::vector<CmdType> commands);
   bool setProperties(CmdType command, std::vector<byte> values);
   void clearBuffer();
 
+  // 失敗の原因を返す版。bool を返す同名の関数はこれらが成功したかどうかを返す
+  CommandResult trySetPassword(const char *pass);
+  CommandResult trySetId(const char *id);
+  CommandResult tryScanChannel(uint32_t channelMask = SCAN_ALL_CHANNELS, int duration = SCAN_MIN_DURATION);
+  CommandResult tryGetIpv6Address();
+  CommandResult trySetChannel();
+  CommandResult trySetPanId();
+  CommandResult trySetSessionLifetime(unsigned int seconds);
+  CommandResult tryRequestAndWaitConnection();
+  CommandResult tryReauthenticate();
+  CommandResult tryConnect(const char *id, const char *password, ConnectionStore *store = nullptr);
+  CommandResult tryGetProperties(std::vector<CmdType> commands);
+  CommandResult trySetProperties(CmdType command, std::vector<byte> values);
+  const CommandResult &getLastResult() const { return _lastResult; } // 最後に完了したブロッキング呼び出し(request*() を含む)の結果
+  ErrorCategory getStartError() const { return _startError; }       // 最後に start*() / *Async() が開始できなかった原因
+
   bool requestCoefficient();                    // 積算電力量係数を取得する(0xD3)
+#ifndef BP35A1_DISABLE_EPC_E0
   bool requestTotalPower();                     // 積算電力量計測値を取得する(0xE0)
+#endif
   bool requestPowerUnit();                      // 積算電力量単位を取得する(0xE1)
+#ifndef BP35A1_DISABLE_EPC_E2
   bool requestCurrentTotalPowerHistories();     // 積算電力量計測値履歴を取得する(0xE2)
+#endif
+#ifndef BP35A1_DISABLE_EPC_E5
   bool requestTotalHistoryCollectionDate();     // 積算履歴収集日を取得する(0xE5)
   bool setTotalHistoryCollectionDate(byte day); // 積算履歴収集日を設定する(0xE5)
+#endif
+#ifndef BP35A1_DISABLE_EPC_E7
   bool requestInstantaneousPower();             // 瞬時電力計測値を取得する(0xE7)
+#endif
+#ifndef BP35A1_DISABLE_EPC_E8
   bool requestInstantaneousAmperage();          // 瞬時電流計測値を取得する(0xE8)
+#endif
+#ifndef BP35A1_DISABLE_EPC_EA
   bool requestCurrentTotalPower();              // 30分毎の積算電力量計測値を取得する(0xEA)
+#endif
+#ifndef BP35A1_DISABLE_EPC_C0
   bool requestBRouteId();                       // Bルート識別番号を取得する(0xC0)
+#endif
+#ifndef BP35A1_DISABLE_EPC_D0
   bool requestOneMinuteTotalPower();            // 1分積算電力量計測値を取得する(0xD0)
+#endif
+#ifndef BP35A1_DISABLE_EPC_D7
   bool requestEffectiveDigits();                // 積算電力量有効桁数を取得する(0xD7)
+#endif
+#ifndef BP35A1_DISABLE_EPC_E3
   bool requestReverseTotalPower();              // 積算電力量計測値(逆方向)を取得する(0xE3)
+#endif
+#ifndef BP35A1_DISABLE_EPC_E4
   bool requestReverseTotalPowerHistories();     // 積算電力量計測値履歴(逆方向)を取得する(0xE4)
+#endif
+#ifndef BP35A1_DISABLE_EPC_EB
   bool requestReverseCurrentTotalPower();       // 定時積算電力量計測値(逆方向)を取得する(0xEB)
+#endif
+#ifndef BP35A1_DISABLE_EPC_EE
   bool requestTotalPowerHistories3();           // 積算電力量計測値履歴3(正逆)を取得する(0xEE)
+#endif
+#ifndef BP35A1_DISABLE_EPC_EF
   bool requestTotalHistoryCollectionDate3();    // 積算履歴収集日3を取得する(0xEF)
   bool setTotalHistoryCollectionDate3(const byte *data); // 積算履歴収集日3を設定する(0xEF)
+#endif
 
   ScanResult getScanResult() { return _scanResult; }
   void setScanResult(ScanResult scanResult) { _scanResult = scanResult; }
+  const std::vector<ScanResult> &getScanCandidates() const { return _scanCandidates; } // 最後のスキャンで見つかった PAN
 
-  int getCoefficient() { return _coefficient.getCoefficient(); }
-  float getTotalPower() { return convertTotalPower(_totalPower.getTotalPower()); }
-  float getPowerUnit() { return _powerUnit.getPowerUnit(); }
-  TotalPowerHistories getTotalPowerHistories() { return _totalPowerHistories; }
-  const byte* getTotalPowerHistoriesRaw() const { return _totalPowerHistoriesRaw.data(); }
-  byte getCollectionDay() { return _collectionDay.getDay(); }
-  int getInstantaneousPower() { return _instantaneousPower.getPower(); }
-  InstantaneousAmperage getInstantaneousAmperage() { return _instantaneousAmperage; }
-  float getCurrentTotalPower() { return convertTotalPower(_currentTotalPower.getTotalPower()); }
-  const byte* getBRouteId() const { return _bRouteId.data(); }
-  const byte* getOneMinuteTotalPower() const { return _oneMinuteTotalPower.data(); }
-  byte getEffectiveDigits() const { return _effectiveDigits; }
-  long getReverseTotalPower() const { return _reverseTotalPower; }
-  const byte* getReverseTotalPowerHistoriesRaw() const { return _reverseTotalPowerHistories.data(); }
-  const byte* getReverseCurrentTotalPowerRaw() const { return _reverseCurrentTotalPower.data(); }
-  const byte* getTotalPowerHistories3Raw() const { return _totalPowerHistories3.data(); }
-  byte getTotalPowerHistories3Length() const { return _totalPowerHistories3Length; }
-  const byte* getTotalHistoryCollectionDate3Raw() const { return _totalHistoryCollectionDate3.data(); }
-
-private:
-  bool waitSuccessResponse(const int timeout = READ_TIMEOUT);
-  bool waitUdpSuccessResponse(const int timeout = READ_TIMEOUT, bool *needRetry = nullptr);
-  bool waitScanResponse(int duration);
-  bool waitIpv6AddrResponse(const int timeout = READ_TIMEOUT);
-  bool requestConnection(); // PANN 接続要求を送信する
-  bool requestReconnection(); // PANA 接続要求を送信する
-  bool waitConnection();    // PANA 接続完了を待つ
+  int getCoefficient() { return _meterData.coefficient.getCoefficient(); }
+  float getPowerUnit() { return _meterData.powerUnit.getPowerUnit(); }
+#ifndef BP35A1_DISABLE_EPC_E0
+  float getTotalPower() { return convertTotalPower(_meterData.totalPower.getTotalPower()); }
+#endif
+#ifndef BP35A1_DISABLE_EPC_E2
+  TotalPowerHistories getTotalPowerHistories() { return _meterData.totalPowerHistories; }
+  const byte* getTotalPowerHistoriesRaw() const { return _meterData.totalPowerHistoriesRaw.data(); }
+#endif
+#ifndef BP35A1_DISABLE_EPC_E5
+  byte getCollectionDay() { return _meterData.collectionDay.getDay(); }
+#endif
+#ifndef BP35A1_DISABLE_EPC_E7
+  int getInstantaneousPower() { return _meterData.instantaneousPower.getPower(); }
+#endif
+#ifndef BP35A1_DISABLE_EPC_E8
+  InstantaneousAmperage getInstantaneousAmperage() { return _meterData.instantaneousAmperage; }
+#endif
+#ifndef BP35A1_DISABLE_EPC_EA
+  float getCurrentTotalPower() { return convertTotalPower(_meterData.currentTotalPower.getTotalPower()); }
+#endif
+#ifndef BP35A1_DISABLE_EPC_C0
+  const byte* getBRouteId() const { return _meterData.bRouteId.data(); }
+#endif
+#ifndef BP35A1_DISABLE_EPC_D0
+  const byte* getOneMinuteTotalPower() const { return _meterData.oneMinuteTotalPower.data(); }
+#endif
+#ifndef BP35A1_DISABLE_EPC_D7
+  byte getEffectiveDigits() const { return _meterData.effectiveDigits; }
+#endif
+#ifndef BP35A1_DISABLE_EPC_E3
+  long getReverseTotalPower() const { return _meterData.reverseTotalPower; }
+#endif
+#ifndef BP35A1_DISABLE_EPC_E4
+  const byte* getReverseTotalPowerHistoriesRaw() const { return _meterData.reverseTotalPowerHistories.data(); }
+#endif
+#ifndef BP35A1_DISABLE_EPC_EB
+  const byte* getReverseCurrentTotalPowerRaw() const { return _meterData.reverseCurrentTotalPower.data(); }
+#endif
+#ifndef BP35A1_DISABLE_EPC_EE
+  const byte* getTotalPowerHistories3Raw() const { return _meterData.totalPowerHistories3.data(); }
+  byte getTotalPowerHistories3Length() const { return _meterData.totalPowerHistories3Length; }
+#endif
+#ifndef BP35A1_DISABLE_EPC_EF
+  const byte* getTotalHistoryCollectionDate3Raw() const { return _meterData.totalHistoryCollectionDate3.data(); }
+#endif
 
-  bool setAsciiMode(bool use_ascii_mode);
-  bool waitRoptResponse(const int timeout = READ_TIMEOUT);  // ROPTコマンドの応答を待つ
+  // 取得した値の一貫したコピー。値を受信した応答・通知ごとに poll() の中で公開される
+  // 上の get*() と違い、poll() と別のスレッド(コア)から呼び出してもよい。書き込みと重なったら読み直すのでロックは要らない
+  MeterSnapshot getSnapshot() const { return _snapshot.load(); }
+  bool tryGetSnapshot(MeterSnapshot *snapshot) const { return _snapshot.tryLoad(snapshot); } // 書き込みと重なったら false
+  uint32_t getSnapshotSequence() const { return _snapshot.getVersion(); } // 前回の sequence と同じなら読み直さなくてよい
 
-  bool sendUdp(std::vector<byte> data);
-  bool waitUdpResponse(const int timeout = READ_TIMEOUT);
-  bool handleUdpResponse(String response);
-  bool handleUdpGetResponse(std::string *data);
-  bool handleUdpSetResponse(std::string *data);
+private:
+  // コマンドの状態遷移で待っている応答
+  enum class CommandState : byte
+  {
+    NONE,
+    WAIT_OK,               // OK / FAIL ER を待つ
+    WAIT_LIFETIME_OK,      // SKSREG S16 の OK を待つ
+    WAIT_ROPT,             // ROPT の応答を待つ
+    WAIT_IPV6_ADDR,        // SKLL64 の応答を待つ
+    WAIT_SCAN_OK,          // SKSCAN の OK を待つ
+    WAIT_SCAN_RESULT,      // EVENT 20 ~ EVENT 22 のスキャン結果を待つ
+    WAIT_SCAN_RETRY,       // 次の duration でスキャンするまで待つ
+    WAIT_JOIN_OK,          // SKJOIN の OK を待つ
+    WAIT_CONNECTION,       // EVENT 25 / EVENT 24 を待つ
+    WAIT_UDP_SENT,         // SKSENDTO の EVENT 21 と OK を待つ
+    WAIT_UDP_REAUTH,       // 送信中に発生した再認証の完了を待つ
+    WAIT_UDP_RESEND        // SKSENDTO を再送するまで待つ
+  };
 
-  template <typename T>
-  T readUdpResponse(std::string *data, int offset)
+  // ライブラリ・モジュールが自分で始めた再認証の状態。ユーザーのコマンドとは別に進める
+  enum class ReauthState : byte
   {
-    int length = T::dataLength();
-    int removeSize = offset + length;
-    std::string str = data->substr(offset, length);
+    NONE,
+    WAIT_OK,        // 送った SKREJOIN の OK / FAIL ER を待つ
+    WAIT_CONNECTION // EVENT 25 / EVENT 24 を待つ
+  };
 
-    *data = data->substr(removeSize);
-    return T(str);
-  }
+  enum class TransactionState : byte
+  {
+    FREE,    // 未使用
+    QUEUED,  // SKSENDTO の送信待ち
+    SENDING, // SKSENDTO の完了待ち
+    WAITING  // ERXUDP の応答待ち
+  };
 
-  template <typename T>
-  bool validateDataLength(const std::string *data, int offset)
+  // 応答待ちの ECHONET Lite 要求
+  struct Transaction
   {
-    int dataSize = data->size();
-    return dataSize >= dataLength<T>(offset);
-  }
+    TransactionState state = TransactionState::FREE;
+    uint16_t tid = 0;
+    byte attempts = 0;      // 送信できなかった・応答がなかった回数
+    byte preparing = 0;     // EVENT 21 ステータス 02 で送り直した回数
+    byte sent = 0;          // SKSENDTO した回数
+    byte event21Status = 0; // 最後に受信した EVENT 21 のステータス
+    ErrorCategory lastFailure = ErrorCategory::NONE; // 最後に再送した原因
+    unsigned long time = 0; // QUEUED: 送信可能になる時刻, WAITING: 送信した時刻(ms)
+    unsigned long started = 0; // 要求を受け付けた時刻(ms)
+    byte length = 0;
+    std::array<byte, BP35A1_MAX_REQUEST_SIZE> frame;
+    AsyncCallback callback;
+    bool oneWay = false;       // 応答を待たない送信(INFC_Res)。TID はメーターのもの
+  };
 
-  template <typename T>
-  int dataLength(int offset)
+  // 完了した要求の結果
+  struct TransactionResult
   {
-    return T::dataLength() + offset;
-  }
+    uint16_t tid = 0;
+    CommandStatus status = CommandStatus::IDLE;
+    CommandResult result = {};
+  };
+
+  bool startCommand(CommandState state, unsigned long timeout);
+  void enterState(CommandState state, unsigned long timeout);
+  void finishCommand(bool success, ErrorCategory error = ErrorCategory::NONE, byte errorCode = 0);
+  CommandResult runCommand(bool started);    // 開始したコマンドの完了を待ち、結果を _lastResult に残す
+  CommandResult runTransaction(uint16_t tid); // 開始した要求の完了を待ち、結果を _lastResult に残す
+  static byte parseErrorCode(const LineView &res); // FAIL ER<code> の番号
+  bool waitForCompletion(); // コマンドが完了するまで poll() を呼び出し続ける
+  bool waitForTransaction(uint16_t tid); // 要求が完了するまで poll() を呼び出し続ける
+
+  void handleLine(const LineView &res);
+  void handleScanLine(const LineView &res);
+  bool selectScanCandidate();
+  void handleUdpSentLine(const LineView &res);
+  void handleTimeout();
+
+  uint16_t startUdpRequest(const std::vector<byte> &data, AsyncCallback callback);
+  template <typename T, typename Getter>
+  uint16_t requestValueAsync(CmdType command, ValueCallback<T> callback, Getter getter);
+  Transaction *allocateTransaction();
+  Transaction *findTransaction(uint16_t tid);
+  void processTransactions();
+  void finishSending(bool success, ErrorCategory error = ErrorCategory::NONE, byte errorCode = 0);
+  void completeSending(); // EVENT 21 と OK がそろった
+  void retryTransaction(Transaction *transaction, RetryReason reason);
+  void finishTransaction(Transaction *transaction, bool success, ErrorCategory error = ErrorCategory::NONE, byte errorCode = 0);
+  void processPollPlan();
+  void processReauthentication();
+  void sendRejoin();                          // poll() の中で再認証を始める。コマンドの状態は変えない
+  bool handleReauthLine(const LineView &res); // 再認証の応答を処理する。コマンドに渡さない行なら true
+  void finishProperty(uint16_t tid, byte epc, bool success);
+  ErrorCategory getPropertyError(CmdType command, uint16_t tid, ErrorCategory error) const; // 複数の EPC をまとめた要求 tid の結果 error から command の結果を求める
+  void sendScan();
+  void sendUdp();
+  bool startGetOutputMode(const char *expected);
+  bool setAsciiMode(bool use_ascii_mode);
+  bool startSetAsciiMode(bool use_ascii_mode);
+
+  void handleUdpResponse(const LineView &response);
+  void handleUdpNotification(EchonetFrame frame);
+  bool queueInfcResponse(EchonetFrame frame);
+  bool handleUdpGetResponse(const EchonetProperty &property);
+  bool handleUdpSetResponse(const EchonetProperty &property);
+  void publishSnapshot(); // _meterData を _snapshot にコピーして公開する
 
-  String readSerialLine(int timeout=READ_TIMEOUT);
   float convertTotalPower(long power); // レスポンスで返ってきた積算電力量を kWh に変換する。未来の時刻の積算電力量は 0 になる
 
-  static String removePrefix(String str, String prefix);
-  static bool validateIpv6Format(String addr);
-  static bool parseHexBytes(const std::string& hex, byte* out, size_t outSize);
+  static bool validateIpv6Format(const LineView &addr);
+  static bool parseHexBytes(const char *hex, size_t hexLength, byte *out, size_t outSize);
 
   void debugLog(const char *format, ...) __attribute__((format(printf, 2, 3)));
 
 public:
   static const std::string SMART_METER_ID; // 低圧スマート電力量メータの識別子
+  static const uint32_t SCAN_ALL_CHANNELS = 0xFFFFFFFF;
+  static const int SCAN_MIN_DURATION = 6;
+  static const int SCAN_MAX_DURATION = 9;
 
 private:
-  HardwareSerial *_serial;
+  static const byte SMART_METER_EOJ[3];
+  Transport *_serial = nullptr;
+  ErxudpFormat _erxudpFormat = ErxudpFormat::ASCII;
   ScanResult _scanResult;
   String _ipv6;
 
-  Coefficient _coefficient;                     // 積算電力量の係数
-  TotalPower _totalPower;                       // 積算電力量計測値(kWh)
-  PowerUnit _powerUnit;                         // 積算電力量の単位
-  TotalPowerHistories _totalPowerHistories;     // 積算電力量計測値履歴
-  std::array<byte, 194> _totalPowerHistoriesRaw = {};
-  CollectionDay _collectionDay;                 // 積算電力量を取得する日(日前)
-  InstantaneousPower _instantaneousPower;       // 瞬時電力計測値
-  InstantaneousAmperage _instantaneousAmperage; // 瞬時電流計測値
-  CurrentTotalPower _currentTotalPower;         // 最新30分毎の積算電力量計測値(kWh)
-  std::array<byte, 16> _bRouteId = {};
-  std::array<byte, 15> _oneMinuteTotalPower = {};
-  byte _effectiveDigits = 0;
-  long _reverseTotalPower = BP35A1UdpResponse::NO_DATA;
-  std::array<byte, 194> _reverseTotalPowerHistories = {};
-  std::array<byte, 11> _reverseCurrentTotalPower = {};
-  std::array<byte, 87> _totalPowerHistories3 = {};
-  byte _totalPowerHistories3Length = 0;
-  std::array<byte, 7> _totalHistoryCollectionDate3 = {};
-
-  unsigned int _lastCertificationTime;
+  MeterData _meterData; // スマートメーターから取得した値
+
+  unsigned long _lastCertificationTime = 0; // 最後に EVENT 25 を受信した時刻(ms)
   unsigned int _panaSessionLifetime = 86400; // PANAセッション有効期限(秒)
+  bool _isAuthenticated = false;             // PANA 認証済み
+  byte _reauthThreshold = 75;                // 有効期限の何 % で再認証するか
+  bool _reauthPending = false;               // 要求がなくなるのを待って再認証する
+  ReauthState _reauthState = ReauthState::NONE; // poll() の中で進めている再認証
+  unsigned long _reauthStartTime = 0;           // 再認証を始めた時刻(ms)
+
+  BP35A1LineBuffer<BP35A1_RX_BUFFER_SIZE> _rxBuffer;    // 受信バッファ
+  std::array<byte, BP35A1_FRAME_BUFFER_SIZE> _rxFrame;  // ERXUDP のデータ部をデコードしたフレーム
+  CommandState _commandState = CommandState::NONE;
+  CommandStatus _commandStatus = CommandStatus::IDLE;
+  CompletionCallback _completionCallback;
+  unsigned long _commandStarted = 0;                    // コマンドを開始した時刻(ms)
+  byte _commandRetries = 0;                             // コマンドの中で再スキャンした回数
+  byte _event21Status = 0;                              // コマンドの中で最後に受信した EVENT 21 のステータス
+  ErrorCategory _startError = ErrorCategory::NONE;      // start*() が false を返した原因
+  CommandResult _commandResult = {};                    // 最後に完了したコマンドの結果
+  CommandResult _lastResult = {};                       // 最後に完了したブロッキング呼び出しの結果
+  unsigned long _stateStartTime = 0;                    // 現在の状態に入った時刻(ms)
+  unsigned long _stateTimeout = 0;                      // 現在の状態のタイムアウト(ms)
+  bool _isReceived = false;                             // EVENT 21 / OK / EVENT 20 の受信済みフラグ
+  uint32_t _scanChannelMask = 0;                       // スキャン中のチャンネルマスク
+  int _scanDuration = 0;                                // スキャン中の duration
+  std::vector<ScanResult> _scanCandidates;              // スキャン中に受信した PAN 情報
+  char _pairId[9] = {};                                 // SKSETRBID で設定した ID の下位 8 文字
+  unsigned int _requestedSessionLifetime = 0;
+  const char *_expectedOutputMode = "";                 // ROPT で期待する応答
+  std::array<Transaction, BP35A1_MAX_TRANSACTIONS> _transactions;      // 送信待ち・応答待ちの要求
+  std::array<TransactionResult, 8> _transactionResults; // 最近完了した要求の結果
+  size_t _nextResult = 0;                               // 次に結果を記録する位置
+  Transaction *_sendingTransaction = nullptr;           // SKSENDTO を実行中の要求
+  uint16_t _nextTid = 1;                                // 次に割り当てる TID。0 は使わない
+  TransactionCallback _transactionCallback;
+  PollPlan _pollPlan;                                   // 定期取得するプロパティ
+  PollCallback _pollCallback;
+  NotificationCallback _notificationCallback;
+  PropertyMap _getRejected;                             // Get_SNA で拒否されたプロパティ
+  PropertyMap _setRejected;                             // SetC_SNA で拒否されたプロパティ
+  PropertyMapCache _propertyMaps;                       // メーターのプロパティマップ
+  PropertyCache _propertyCache;                         // 値を受信した時刻と取得中の要求
+  Seqlock<MeterSnapshot> _snapshot;                     // 他のスレッドに公開する _meterData のコピー
+  RetryPolicy _retryPolicy;
+  uint32_t _retryRandom = 2463534242UL;                 // 再送の待ち時間のゆらぎに使う乱数の状態
+  bool _sendFailed = false;                             // SKSENDTO の EVENT 21 が 00 以外だった
+  RetryReason _sendFailure = RetryReason::SEND_FAILED;  // _sendFailed のときの理由
 
   static const int READ_TIMEOUT = 5000;
   static const int READ_INTERVAL = 100;
+  static const int POLL_INTERVAL = 1;
+  static const int SCAN_RETRY_INTERVAL = 1000;
+  static const size_t MAX_SCAN_CANDIDATES = 8;
   static const int CONNECTION_TIMEOUT = 30000;
 };
 
+// 既存のスケッチ向けの名前。Arduino では HardwareSerial を直接使う
+// ホストではエミュレータと LinuxSerialPort を実行時に取り替えられるよう SerialPort(仮想関数)を使う
+// シリアルの種類が決まっているなら BasicBP35A1<LinuxSerialPort> などを使うと仮想関数を経由しない
+// この組み合わせは bp35a1.cpp で実体化済み
+#ifdef ARDUINO
+extern template class BasicBP35A1<HardwareSerial>;
+typedef BasicBP35A1<HardwareSerial> BP35A1;
+#else
+extern template class BasicBP35A1<SerialPort>;
+typedef BasicBP35A1<SerialPort> BP35A1;
+#endif
+
+#include "bp35a1_Impl.h"
+
 #endif
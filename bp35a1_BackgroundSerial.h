@@ -0,0 +1,250 @@
+#ifndef BP35A1_BACKGROUND_SERIAL_H_
+#define BP35A1_BACKGROUND_SERIAL_H_
+
+#include "bp35a1_SerialPort.h"
+#include "bp35a1_SpscRing.h"
+
+// 受信専用のスレッド(ESP32 では FreeRTOS タスク)がないプラットフォームでは使えない
+#if !defined(ARDUINO) || defined(ARDUINO_ARCH_ESP32)
+#define BP35A1_HAS_BACKGROUND_SERIAL 1
+
+#include <atomic>
+
+#ifdef ARDUINO
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#else
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+// 受信スレッドとの間のリングバッファの大きさ(バイト)。2 のべき乗
+#ifndef BP35A1_BACKGROUND_RX_SIZE
+#define BP35A1_BACKGROUND_RX_SIZE 4096
+#endif
+
+#ifdef ARDUINO
+#ifndef BP35A1_BACKGROUND_TASK_PRIORITY
+#define BP35A1_BACKGROUND_TASK_PRIORITY 2 // loop() より高くする
+#endif
+#ifndef BP35A1_BACKGROUND_TASK_CORE
+#define BP35A1_BACKGROUND_TASK_CORE tskNO_AFFINITY
+#endif
+#ifndef BP35A1_BACKGROUND_TASK_STACK
+#define BP35A1_BACKGROUND_TASK_STACK 2048
+#endif
+#endif
+
+// Port からの受信を専用のスレッドで読み続け、ロックフリーのリングバッファに溜める SerialPort
+// BP35A1 は UART ではなくリングバッファから読むので、wait*() や poll() の外で届いたデータ
+// (EVENT 29、遅れた ERXUDP、長い履歴の応答など)も UART のバッファをあふれさせずに受け取れる
+// 送信は呼び出したスレッドから Port に直接書き込む。Port は読み書きを別スレッドから行えること
+//
+//   BackgroundSerial<HardwareSerial> rx(&Serial2);
+//   BasicBP35A1<BackgroundSerial<HardwareSerial>> bp35a1(&rx);
+//   rx.begin();
+template <typename Port>
+class BackgroundSerial final : public SerialPort
+{
+public:
+  explicit BackgroundSerial(Port *port) : _port(port) {}
+  ~BackgroundSerial() override { end(); }
+  BackgroundSerial(const BackgroundSerial &) = delete;
+  BackgroundSerial &operator=(const BackgroundSerial &) = delete;
+
+  bool begin(); // 受信スレッドを開始する
+  void end();   // 受信スレッドを止める。溜まっているデータはそのまま読める
+  bool isRunning() const { return _running.load(); }
+  unsigned long getStallCount() const { return _stalls.load(); } // リングバッファが一杯で読み出しを待たせた回数
+
+  int available() override { return _ring.size(); }
+  int read() override
+  {
+    char c;
+    return _ring.read(&c, 1) == 1 ? static_cast<byte>(c) : -1;
+  }
+  size_t readBytes(char *buffer, size_t length) override { return _ring.read(buffer, length); }
+  size_t write(const byte *data, size_t size) override { return _port->write(data, size); }
+  using SerialPort::write;
+  bool waitForData(unsigned long timeoutMs) override;
+
+private:
+  void run();    // 受信スレッドの本体
+  void notify(); // 受信を待っているスレッドを起こす
+
+  Port *_port;
+  SpscRing<BP35A1_BACKGROUND_RX_SIZE> _ring;
+  std::atomic<bool> _running{false};
+  std::atomic<unsigned long> _stalls{0};
+#ifdef ARDUINO
+  static void taskEntry(void *arg);
+
+  TaskHandle_t _task = nullptr;
+  SemaphoreHandle_t _signal = nullptr;
+  std::atomic<bool> _stopped{true};
+  static const unsigned long READ_WAIT = 1; // HardwareSerial は受信を待てないので短く区切る
+#else
+  std::thread _thread;
+  std::mutex _mutex; // 受信待ちの休止だけに使う。データはリングバッファで受け渡す
+  std::condition_variable _received;
+  static const unsigned long READ_WAIT = 50; // end() に気付くまでの最大時間
+#endif
+};
+
+template <typename Port>
+void BackgroundSerial<Port>::run()
+{
+  char chunk[128];
+  bool stalled = false;
+  while (_running.load())
+  {
+    size_t space = _ring.space();
+    if (space == 0)
+    {
+      // 読み出されるまで Port 側のバッファに残しておく
+      if (!stalled)
+      {
+        _stalls.fetch_add(1);
+        stalled = true;
+      }
+      notify();
+      MillisClock::sleep(1);
+      continue;
+    }
+    stalled = false;
+
+    int available = _port->available();
+    if (available <= 0)
+    {
+      waitForSerialData<MillisClock>(_port, READ_WAIT);
+      continue;
+    }
+    size_t length = std::min(std::min(static_cast<size_t>(available), space), sizeof(chunk));
+    length = _port->readBytes(chunk, length);
+    if (length > 0)
+    {
+      _ring.write(chunk, length);
+      notify();
+    }
+  }
+}
+
+#ifdef ARDUINO
+
+template <typename Port>
+bool BackgroundSerial<Port>::begin()
+{
+  if (_running.load())
+  {
+    return true;
+  }
+  if (_signal == nullptr && (_signal = xSemaphoreCreateBinary()) == nullptr)
+  {
+    log_e("BackgroundSerial::begin(): Cannot create semaphore");
+    return false;
+  }
+  _running = true;
+  _stopped = false;
+  if (xTaskCreatePinnedToCore(taskEntry, "bp35a1_rx", BP35A1_BACKGROUND_TASK_STACK, this,
+                              BP35A1_BACKGROUND_TASK_PRIORITY, &_task, BP35A1_BACKGROUND_TASK_CORE) != pdPASS)
+  {
+    log_e("BackgroundSerial::begin(): Cannot create task");
+    _running = false;
+    _stopped = true;
+    return false;
+  }
+  return true;
+}
+
+template <typename Port>
+void BackgroundSerial<Port>::end()
+{
+  _running = false;
+  while (!_stopped.load())
+  {
+    delay(1);
+  }
+  _task = nullptr;
+}
+
+template <typename Port>
+void BackgroundSerial<Port>::taskEntry(void *arg)
+{
+  BackgroundSerial *self = static_cast<BackgroundSerial *>(arg);
+  self->run();
+  self->_stopped = true;
+  vTaskDelete(nullptr);
+}
+
+template <typename Port>
+void BackgroundSerial<Port>::notify()
+{
+  xSemaphoreGive(_signal);
+}
+
+template <typename Port>
+bool BackgroundSerial<Port>::waitForData(unsigned long timeoutMs)
+{
+  if (!_ring.empty() || !_running.load())
+  {
+    return !_ring.empty();
+  }
+  xSemaphoreTake(_signal, pdMS_TO_TICKS(timeoutMs));
+  return !_ring.empty();
+}
+
+#else
+
+template <typename Port>
+bool BackgroundSerial<Port>::begin()
+{
+  if (_running.load())
+  {
+    return true;
+  }
+  _running = true;
+  _thread = std::thread(&BackgroundSerial::run, this);
+  return true;
+}
+
+template <typename Port>
+void BackgroundSerial<Port>::end()
+{
+  _running = false;
+  if (_thread.joinable())
+  {
+    _thread.join();
+  }
+}
+
+template <typename Port>
+void BackgroundSerial<Port>::notify()
+{
+  // 待つ側が条件を確かめてから眠るまでの間に通知が失われないよう、ロックを通過させる
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+  }
+  _received.notify_one();
+}
+
+template <typename Port>
+bool BackgroundSerial<Port>::waitForData(unsigned long timeoutMs)
+{
+  if (!_ring.empty() || !_running.load())
+  {
+    return !_ring.empty();
+  }
+  std::unique_lock<std::mutex> lock(_mutex);
+  _received.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]
+                     { return !_ring.empty(); });
+  return !_ring.empty();
+}
+
+#endif
+
+#endif
+
+#endif
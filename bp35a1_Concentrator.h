@@ -0,0 +1,319 @@
+#ifndef BP35A1_CONCENTRATOR_H_
+#define BP35A1_CONCENTRATOR_H_
+
+#include "bp35a1.h"
+
+// まとめて扱える BP35A1 の数
+#ifndef BP35A1_MAX_LINKS
+#define BP35A1_MAX_LINKS 16
+#endif
+
+// 複数の BP35A1(1 台のスマートメーターにつき 1 つのシリアル)を 1 つのスレッドで並行して動かす
+// 接続手順と定期取得はリンクごとにノンブロッキングで進むので、応答の遅いメーターが他を止めない
+// 状態はすべてリンクごとに持つ
+template <typename Transport, typename Clock = MillisClock>
+class BasicConcentrator
+{
+public:
+  typedef BasicBP35A1<Transport, Clock> Device;
+  typedef std::function<void(size_t link, CmdType command, CommandStatus status)> ReadingCallback;
+
+  enum class LinkState : byte
+  {
+    IDLE,       // begin() 前
+    CONNECTING, // スキャンから PANA 接続まで実行中
+    CONNECTED,  // 定期取得中
+    WAITING     // 接続に失敗し、再接続を待っている
+  };
+
+  struct LinkStats
+  {
+    unsigned long succeeded = 0;     // 取得できたプロパティの数
+    unsigned long failed = 0;        // 取得できなかったプロパティの数
+    unsigned long connections = 0;   // 接続に成功した回数
+    unsigned long connectedAt = 0;   // 最後に接続した時刻(ms)
+    unsigned long sessionLosses = 0; // 接続後に PANA セッションが切れた回数
+  };
+
+  // リンクを追加する。戻り値はリンクの番号。追加できなければ -1
+  // device・id・password は Concentrator より長く有効であること
+  int addLink(Device *device, const char *id, const char *password);
+  bool addPollProperty(CmdType command, unsigned long interval); // 全リンクで定期取得する
+  void setReadingCallback(ReadingCallback callback) { _readingCallback = callback; }
+
+  void begin(); // 全リンクの接続を始める。出力形式の確認も接続手順の中で行う
+  void poll();  // 全リンクの受信データを処理し、接続手順と定期取得を進める
+
+  size_t size() const { return _links.size(); }
+  Device *getDevice(size_t link) { return _links[link].device; }
+  LinkState getLinkState(size_t link) const { return _links[link].state; }
+  const LinkStats &getLinkStats(size_t link) const { return _links[link].stats; }
+  size_t getConnectedCount() const;
+
+private:
+  // 接続手順。start*() を順に実行する
+  enum class Step : byte
+  {
+    OUTPUT_MODE,     // ROPT。コンストラクタで指定した形式なら SET_OUTPUT_MODE を飛ばす
+    SET_OUTPUT_MODE, // WOPT
+    PASSWORD,
+    ID,
+    SCAN,
+    IPV6_ADDRESS,
+    CHANNEL,
+    PAN_ID,
+    CONNECTION,
+    DONE
+  };
+
+  struct Link
+  {
+    Device *device = nullptr;
+    const char *id = "";
+    const char *password = "";
+    LinkState state = LinkState::IDLE;
+    Step step = Step::PASSWORD;
+    bool started = false;       // 現在のステップのコマンドを開始済み
+    unsigned long failedAt = 0; // WAITING: 接続に失敗した時刻(ms)
+    LinkStats stats;
+  };
+
+  struct PollProperty
+  {
+    CmdType command;
+    unsigned long interval;
+  };
+
+  void connect(size_t index);
+  void fail(size_t index); // 接続手順を中断し、RECONNECT_INTERVAL 後にやり直す
+  void lose(size_t index); // 接続後にセッションが切れた。すぐに SKJOIN し直す
+  bool startStep(Link &link);
+  void onConnected(size_t index);
+
+  std::vector<Link> _links;
+  std::vector<PollProperty> _pollProperties;
+  ReadingCallback _readingCallback;
+
+  static const unsigned long RECONNECT_INTERVAL = 10000;
+};
+
+template <typename Transport, typename Clock>
+int BasicConcentrator<Transport, Clock>::addLink(Device *device, const char *id, const char *password)
+{
+  if (_links.size() >= BP35A1_MAX_LINKS)
+  {
+    log_e("BasicConcentrator::addLink(): Too many links");
+    return -1;
+  }
+  Link link;
+  link.device = device;
+  link.id = id;
+  link.password = password;
+  _links.push_back(link);
+  return _links.size() - 1;
+}
+
+template <typename Transport, typename Clock>
+bool BasicConcentrator<Transport, Clock>::addPollProperty(CmdType command, unsigned long interval)
+{
+  _pollProperties.push_back({command, interval});
+  bool added = true;
+  for (auto &link : _links)
+  {
+    if (link.state == LinkState::CONNECTED)
+    {
+      added = link.device->addPollProperty(command, interval) && added;
+    }
+  }
+  return added;
+}
+
+template <typename Transport, typename Clock>
+void BasicConcentrator<Transport, Clock>::begin()
+{
+  for (size_t i = 0; i < _links.size(); i++)
+  {
+    Link &link = _links[i];
+    // コールバックにはリンクの番号を渡す
+    link.device->setPollCallback([this, i](CmdType command, CommandStatus status)
+                                 {
+                                   LinkStats &stats = _links[i].stats;
+                                   if (status == CommandStatus::SUCCEEDED)
+                                     stats.succeeded++;
+                                   else
+                                     stats.failed++;
+                                   if (_readingCallback)
+                                     _readingCallback(i, command, status);
+                                 });
+    connect(i);
+  }
+}
+
+template <typename Transport, typename Clock>
+void BasicConcentrator<Transport, Clock>::poll()
+{
+  for (size_t i = 0; i < _links.size(); i++)
+  {
+    Link &link = _links[i];
+    link.device->poll();
+
+    switch (link.state)
+    {
+    case LinkState::CONNECTING:
+      if (link.device->isBusy())
+      {
+        break;
+      }
+      if (link.started)
+      {
+        bool succeeded = link.device->getCommandStatus() == CommandStatus::SUCCEEDED;
+        if (link.step == Step::OUTPUT_MODE)
+        {
+          // 出力形式が違う(または ROPT に応答しない)場合だけ WOPT する
+          link.step = succeeded ? Step::PASSWORD : Step::SET_OUTPUT_MODE;
+        }
+        else if (!succeeded)
+        {
+          fail(i);
+          break;
+        }
+        else
+        {
+          link.step = static_cast<Step>(static_cast<byte>(link.step) + 1);
+        }
+        link.started = false;
+      }
+      if (link.step == Step::DONE)
+      {
+        onConnected(i);
+      }
+      else if (startStep(link))
+      {
+        link.started = true;
+      }
+      else
+      {
+        fail(i);
+      }
+      break;
+    case LinkState::CONNECTED:
+      if (!link.device->isAuthenticated() && !link.device->isBusy())
+      {
+        lose(i);
+      }
+      break;
+    case LinkState::WAITING:
+      if (Clock::now() - link.failedAt >= RECONNECT_INTERVAL)
+      {
+        connect(i);
+      }
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+template <typename Transport, typename Clock>
+size_t BasicConcentrator<Transport, Clock>::getConnectedCount() const
+{
+  size_t count = 0;
+  for (const auto &link : _links)
+  {
+    if (link.state == LinkState::CONNECTED)
+    {
+      count++;
+    }
+  }
+  return count;
+}
+
+template <typename Transport, typename Clock>
+void BasicConcentrator<Transport, Clock>::connect(size_t index)
+{
+  Link &link = _links[index];
+  link.state = LinkState::CONNECTING;
+  link.step = Step::OUTPUT_MODE;
+  link.started = false;
+}
+
+template <typename Transport, typename Clock>
+void BasicConcentrator<Transport, Clock>::fail(size_t index)
+{
+  Link &link = _links[index];
+  log_w("BasicConcentrator::fail(): Link %u failed to connect at step %d", static_cast<unsigned>(index), static_cast<int>(link.step));
+  link.state = LinkState::WAITING;
+  link.failedAt = Clock::now();
+}
+
+template <typename Transport, typename Clock>
+void BasicConcentrator<Transport, Clock>::lose(size_t index)
+{
+  Link &link = _links[index];
+  link.stats.sessionLosses++;
+  link.device->clearPollPlan();
+  if (Clock::now() - link.stats.connectedAt < RECONNECT_INTERVAL)
+  {
+    // 接続してすぐに切れる場合は、続けて SKJOIN しないよう待ってから最初からやり直す
+    log_w("BasicConcentrator::lose(): Link %u lost the PANA session again", static_cast<unsigned>(index));
+    link.state = LinkState::WAITING;
+    link.failedAt = Clock::now();
+    return;
+  }
+  // スキャン結果とチャンネル・PAN ID は変わらないので、SKJOIN からやり直す
+  // 失敗すれば fail() で RECONNECT_INTERVAL 後に最初から接続する
+  log_w("BasicConcentrator::lose(): Link %u lost the PANA session, rejoining", static_cast<unsigned>(index));
+  link.state = LinkState::CONNECTING;
+  link.step = Step::CONNECTION;
+  link.started = false;
+}
+
+template <typename Transport, typename Clock>
+bool BasicConcentrator<Transport, Clock>::startStep(Link &link)
+{
+  switch (link.step)
+  {
+  case Step::OUTPUT_MODE:
+    return link.device->startGetErxudpFormat();
+  case Step::SET_OUTPUT_MODE:
+    return link.device->startSetErxudpFormat();
+  case Step::PASSWORD:
+    return link.device->startSetPassword(link.password);
+  case Step::ID:
+    return link.device->startSetId(link.id);
+  case Step::SCAN:
+    return link.device->startScanChannel();
+  case Step::IPV6_ADDRESS:
+    return link.device->startGetIpv6Address();
+  case Step::CHANNEL:
+    return link.device->startSetChannel();
+  case Step::PAN_ID:
+    return link.device->startSetPanId();
+  case Step::CONNECTION:
+    return link.device->startConnection();
+  default:
+    return false;
+  }
+}
+
+template <typename Transport, typename Clock>
+void BasicConcentrator<Transport, Clock>::onConnected(size_t index)
+{
+  Link &link = _links[index];
+  link.state = LinkState::CONNECTED;
+  link.stats.connections++;
+  link.stats.connectedAt = Clock::now();
+  for (const auto &property : _pollProperties)
+  {
+    link.device->addPollProperty(property.command, property.interval);
+  }
+}
+
+// ホストの Concentrator は BP35A1 と同じく SerialPort を使い、エミュレータと実機を混ぜられる
+#ifdef ARDUINO
+typedef BasicConcentrator<HardwareSerial> Concentrator;
+#else
+typedef BasicConcentrator<SerialPort> Concentrator;
+#endif
+
+#endif
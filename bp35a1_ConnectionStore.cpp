@@ -0,0 +1,146 @@
+#include "bp35a1_ConnectionStore.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <Preferences.h>
+#endif
+
+bool ConnectionInfo::isValid() const
+{
+  // 例: Channel 21, Pan ID 8888, Addr 001D129012345678, FE80:0000:0000:0000:021D:1290:1234:5678
+  return scanResult.channel.length() == 2 && scanResult.panId.length() == 4 && scanResult.addr.length() == 16 &&
+         ipv6.length() == 39;
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+bool PreferencesConnectionStore::load(ConnectionInfo *info)
+{
+  Preferences preferences;
+  if (!preferences.begin(_name, true))
+  {
+    return false;
+  }
+  ConnectionInfo loaded;
+  loaded.scanResult.channel = preferences.getString("channel");
+  loaded.scanResult.panId = preferences.getString("panId");
+  loaded.scanResult.addr = preferences.getString("addr");
+  loaded.ipv6 = preferences.getString("ipv6");
+  preferences.end();
+  if (!loaded.isValid())
+  {
+    return false;
+  }
+  *info = loaded;
+  return true;
+}
+
+bool PreferencesConnectionStore::save(const ConnectionInfo &info)
+{
+  Preferences preferences;
+  if (!info.isValid() || !preferences.begin(_name, false))
+  {
+    return false;
+  }
+  bool saved = preferences.putString("channel", info.scanResult.channel) > 0 &&
+               preferences.putString("panId", info.scanResult.panId) > 0 &&
+               preferences.putString("addr", info.scanResult.addr) > 0 &&
+               preferences.putString("ipv6", info.ipv6) > 0;
+  preferences.end();
+  return saved;
+}
+
+void PreferencesConnectionStore::clear()
+{
+  Preferences preferences;
+  if (preferences.begin(_name, false))
+  {
+    preferences.clear();
+    preferences.end();
+  }
+}
+
+#endif
+
+#ifndef ARDUINO
+
+namespace
+{
+  const char *const FILE_HEADER = "BP35A1 connection 1"; // 形式を変えたら番号を上げる
+
+  bool readLine(FILE *file, std::string *line)
+  {
+    char buf[64];
+    if (fgets(buf, sizeof(buf), file) == nullptr)
+    {
+      return false;
+    }
+    *line = buf;
+    while (!line->empty() && (line->back() == '\n' || line->back() == '\r'))
+    {
+      line->pop_back();
+    }
+    return true;
+  }
+}
+
+bool FileConnectionStore::load(ConnectionInfo *info)
+{
+  FILE *file = fopen(_path.c_str(), "r");
+  if (file == nullptr)
+  {
+    return false;
+  }
+  std::string header, channel, panId, addr, ipv6;
+  bool read = readLine(file, &header) && readLine(file, &channel) && readLine(file, &panId) &&
+              readLine(file, &addr) && readLine(file, &ipv6);
+  fclose(file);
+  if (!read || header != FILE_HEADER)
+  {
+    return false;
+  }
+
+  ConnectionInfo loaded;
+  loaded.scanResult.channel = channel;
+  loaded.scanResult.panId = panId;
+  loaded.scanResult.addr = addr;
+  loaded.ipv6 = ipv6;
+  if (!loaded.isValid())
+  {
+    return false;
+  }
+  *info = loaded;
+  return true;
+}
+
+bool FileConnectionStore::save(const ConnectionInfo &info)
+{
+  if (!info.isValid())
+  {
+    return false;
+  }
+  // 書き込み途中で止まっても前回の内容が壊れないよう、別名で書いてから置き換える
+  std::string temporary = _path + ".tmp";
+  FILE *file = fopen(temporary.c_str(), "w");
+  if (file == nullptr)
+  {
+    log_e("FileConnectionStore::save(): Cannot open %s", temporary.c_str());
+    return false;
+  }
+  bool written = fprintf(file, "%s\n%s\n%s\n%s\n%s\n", FILE_HEADER, info.scanResult.channel.c_str(),
+                         info.scanResult.panId.c_str(), info.scanResult.addr.c_str(), info.ipv6.c_str()) > 0;
+  written = fclose(file) == 0 && written;
+  if (!written || rename(temporary.c_str(), _path.c_str()) != 0)
+  {
+    log_e("FileConnectionStore::save(): Cannot write %s", _path.c_str());
+    remove(temporary.c_str());
+    return false;
+  }
+  return true;
+}
+
+void FileConnectionStore::clear()
+{
+  remove(_path.c_str());
+}
+
+#endif
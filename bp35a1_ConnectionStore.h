@@ -0,0 +1,67 @@
+#ifndef BP35A1_CONNECTION_STORE_H_
+#define BP35A1_CONNECTION_STORE_H_
+
+#include "bp35a1_Platform.h"
+
+struct ScanResult
+{
+  String channel;
+  String panId;
+  String addr;
+  byte lqi = 0;  // 受信 LQI。大きいほど電波状態が良い(RSSI = 0.275 * LQI - 104.27 dBm)
+  String pairId; // 相手の Pairing ID(B ルート ID の下位 8 文字)
+};
+
+// 接続に成功したときの PAN の情報。次回起動時にスキャンを省くために保存する
+struct ConnectionInfo
+{
+  ScanResult scanResult;
+  String ipv6; // スマートメーターの IPv6 アドレス(SKLL64 の結果)
+
+  bool isValid() const; // 各項目が BP35A1 の表記の長さになっている
+};
+
+// ConnectionInfo の保存先
+class ConnectionStore
+{
+public:
+  virtual ~ConnectionStore() {}
+
+  virtual bool load(ConnectionInfo *info) = 0; // 保存されていなければ false
+  virtual bool save(const ConnectionInfo &info) = 0;
+  virtual void clear() = 0;
+};
+
+#if defined(ARDUINO_ARCH_ESP32)
+// ESP32 の NVS(Preferences)に保存する
+class PreferencesConnectionStore : public ConnectionStore
+{
+public:
+  explicit PreferencesConnectionStore(const char *name = "bp35a1") : _name(name) {}
+
+  bool load(ConnectionInfo *info) override;
+  bool save(const ConnectionInfo &info) override;
+  void clear() override;
+
+private:
+  const char *_name; // Preferences の名前空間
+};
+#endif
+
+#ifndef ARDUINO
+// ファイルに保存する
+class FileConnectionStore : public ConnectionStore
+{
+public:
+  explicit FileConnectionStore(const char *path) : _path(path) {}
+
+  bool load(ConnectionInfo *info) override;
+  bool save(const ConnectionInfo &info) override;
+  void clear() override;
+
+private:
+  std::string _path;
+};
+#endif
+
+#endif
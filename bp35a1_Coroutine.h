@@ -0,0 +1,365 @@
+#ifndef BP35A1_COROUTINE_H_
+#define BP35A1_COROUTINE_H_
+
+#include "bp35a1.h"
+
+// C++20 のコルーチンで BP35A1 を扱う(Linux などのホスト向け)
+// ライブラリ本体は C++11 のままで、このヘッダを読み込む翻訳単位だけ C++20 でコンパイルする
+#if !defined(ARDUINO) && defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define BP35A1_HAS_COROUTINE 1
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+
+// co_await できるタスク。生成しただけでは実行されず、co_await されるか start() で開始する
+template <typename T = void>
+class CoTask;
+
+namespace bp35a1_detail
+{
+  template <typename Promise>
+  struct FinalAwaiter
+  {
+    bool await_ready() noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+    {
+      // 待っているコルーチンがあれば続きを実行する
+      std::coroutine_handle<> continuation = handle.promise().continuation;
+      return continuation ? continuation : std::noop_coroutine();
+    }
+    void await_resume() noexcept {}
+  };
+
+  struct PromiseBase
+  {
+    std::coroutine_handle<> continuation;
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    void unhandled_exception() { std::terminate(); }
+  };
+}
+
+template <typename T>
+class CoTask
+{
+public:
+  struct promise_type : bp35a1_detail::PromiseBase
+  {
+    std::optional<T> value;
+
+    CoTask get_return_object() { return CoTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+    bp35a1_detail::FinalAwaiter<promise_type> final_suspend() noexcept { return {}; }
+    void return_value(T result) { value = std::move(result); }
+  };
+
+  CoTask(CoTask &&other) noexcept : _handle(std::exchange(other._handle, nullptr)) {}
+  CoTask(const CoTask &) = delete;
+  CoTask &operator=(const CoTask &) = delete;
+  ~CoTask()
+  {
+    if (_handle)
+    {
+      _handle.destroy();
+    }
+  }
+
+  void start() { _handle.resume(); } // 最上位のタスクを開始する。続きは CoBP35A1::poll() の中で進む
+  bool done() const { return _handle.done(); }
+  const T &result() const { return *_handle.promise().value; }
+
+  struct Awaiter
+  {
+    std::coroutine_handle<promise_type> handle;
+
+    bool await_ready() const { return handle.done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting)
+    {
+      handle.promise().continuation = awaiting;
+      return handle;
+    }
+    T await_resume() { return std::move(*handle.promise().value); }
+  };
+  Awaiter operator co_await() const { return {_handle}; }
+
+private:
+  explicit CoTask(std::coroutine_handle<promise_type> handle) : _handle(handle) {}
+
+  std::coroutine_handle<promise_type> _handle;
+};
+
+template <>
+class CoTask<void>
+{
+public:
+  struct promise_type : bp35a1_detail::PromiseBase
+  {
+    CoTask get_return_object() { return CoTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+    bp35a1_detail::FinalAwaiter<promise_type> final_suspend() noexcept { return {}; }
+    void return_void() {}
+  };
+
+  CoTask(CoTask &&other) noexcept : _handle(std::exchange(other._handle, nullptr)) {}
+  CoTask(const CoTask &) = delete;
+  CoTask &operator=(const CoTask &) = delete;
+  ~CoTask()
+  {
+    if (_handle)
+    {
+      _handle.destroy();
+    }
+  }
+
+  void start() { _handle.resume(); }
+  bool done() const { return _handle.done(); }
+
+  struct Awaiter
+  {
+    std::coroutine_handle<promise_type> handle;
+
+    bool await_ready() const { return handle.done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting)
+    {
+      handle.promise().continuation = awaiting;
+      return handle;
+    }
+    void await_resume() {}
+  };
+  Awaiter operator co_await() const { return {_handle}; }
+
+private:
+  explicit CoTask(std::coroutine_handle<promise_type> handle) : _handle(handle) {}
+
+  std::coroutine_handle<promise_type> _handle;
+};
+
+// BasicBP35A1 のコマンドとプロパティ要求を co_await できるようにする
+// 中断したコルーチンは poll() の中で再開されるので、イベントループから poll() を呼び続ける
+// 待っている途中で CoTask を破棄してもよい。待っていた要求・コマンドは続くが、完了しても再開しない
+//
+//   CoTask<> run(CoBP35A1<SerialPort> &meter)
+//   {
+//     AsyncResult result = co_await meter.get(CmdType::INSTANTANEOUS_POWER);
+//   }
+template <typename Transport, typename Clock = MillisClock>
+class CoBP35A1
+{
+public:
+  typedef BasicBP35A1<Transport, Clock> Device;
+
+  explicit CoBP35A1(Device *device) : _device(device) {}
+  CoBP35A1(const CoBP35A1 &) = delete;
+  CoBP35A1 &operator=(const CoBP35A1 &) = delete;
+
+  Device *device() { return _device; }
+
+  // 受信データを処理し、完了した要求・コマンド・タイマーを待っているコルーチンを再開する
+  void poll()
+  {
+    _device->poll();
+    if (_command != nullptr && !_device->isBusy())
+    {
+      CommandAwaiter *command = std::exchange(_command, nullptr);
+      command->result = _device->getCommandStatus() == CommandStatus::SUCCEEDED;
+      _ready.push_back(command->handle);
+    }
+    unsigned long now = Clock::now();
+    for (auto it = _timers.begin(); it != _timers.end();)
+    {
+      if (now - it->start >= it->duration)
+      {
+        _ready.push_back(it->handle);
+        it = _timers.erase(it);
+      }
+      else
+      {
+        ++it;
+      }
+    }
+    // 再開したコルーチンが新たに積んだものは次の poll() で再開する
+    // 再開したコルーチンが他のタスクを破棄した場合に備え、1 つずつ取り出す
+    _resuming.swap(_ready);
+    while (!_resuming.empty())
+    {
+      std::coroutine_handle<> handle = _resuming.front();
+      _resuming.pop_front();
+      handle.resume();
+    }
+  }
+
+  bool idle() const { return _command == nullptr && _ready.empty() && _timers.empty() && _device->getPendingTransactionCount() == 0; }
+
+  // ECHONET Lite 要求の完了を待つ。要求を受け付けられなければ FAILED と開始できなかった原因ですぐに再開する
+  struct TransactionAwaiter
+  {
+    CoBP35A1 *owner;
+    std::vector<CmdType> commands;
+    std::vector<byte> values; // Set の場合の値
+    bool isSet;
+    AsyncResult result = {0, CommandStatus::FAILED, 0, ErrorCategory::NONE, 0, 0};
+    std::coroutine_handle<> handle;
+    std::shared_ptr<bool> alive; // 待っている間 true。破棄されたら完了しても触らない
+
+    ~TransactionAwaiter()
+    {
+      if (alive)
+      {
+        *alive = false;
+      }
+      owner->forget(handle);
+    }
+
+    bool await_ready() const { return false; }
+    bool await_suspend(std::coroutine_handle<> awaiting)
+    {
+      std::shared_ptr<bool> flag = std::make_shared<bool>(true);
+      auto callback = [this, awaiting, flag](const AsyncResult &completed)
+      {
+        if (!*flag)
+        {
+          return;
+        }
+        result = completed;
+        owner->_ready.push_back(awaiting);
+      };
+      uint16_t tid = isSet ? owner->_device->setPropertiesAsync(commands.front(), values, callback)
+                           : owner->_device->getPropertiesAsync(commands, callback);
+      if (tid == 0)
+      {
+        result.error = owner->_device->getStartError();
+        return false;
+      }
+      handle = awaiting;
+      alive = flag;
+      return true;
+    }
+    AsyncResult await_resume() const { return result; }
+  };
+
+  // コマンド(SKSCAN / SKJOIN など)の完了を待つ。結果は成功したかどうか
+  // コマンドは 1 つずつしか実行できない。開始できなければ false ですぐに再開する
+  struct CommandAwaiter
+  {
+    CoBP35A1 *owner;
+    std::function<bool()> start; // start*() を呼び出す
+    bool result = false;
+    std::coroutine_handle<> handle;
+
+    ~CommandAwaiter()
+    {
+      if (owner->_command == this)
+      {
+        owner->_command = nullptr;
+      }
+      owner->forget(handle);
+    }
+
+    bool await_ready() const { return false; }
+    bool await_suspend(std::coroutine_handle<> awaiting)
+    {
+      if (owner->_command != nullptr || !start())
+      {
+        return false;
+      }
+      handle = awaiting;
+      owner->_command = this;
+      return true;
+    }
+    bool await_resume() const { return result; }
+  };
+
+  // 指定した時間だけ待つ
+  struct SleepAwaiter
+  {
+    CoBP35A1 *owner;
+    unsigned long duration;
+    std::coroutine_handle<> handle;
+
+    ~SleepAwaiter() { owner->forget(handle); }
+
+    bool await_ready() const { return duration == 0; }
+    void await_suspend(std::coroutine_handle<> awaiting)
+    {
+      handle = awaiting;
+      owner->_timers.push_back({awaiting, Clock::now(), duration});
+    }
+    void await_resume() const {}
+  };
+
+  TransactionAwaiter get(CmdType command) { return {this, {command}, {}, false, {0, CommandStatus::FAILED, 0, ErrorCategory::NONE, 0, 0}, {}, {}}; }
+  TransactionAwaiter get(std::vector<CmdType> commands) { return {this, std::move(commands), {}, false, {0, CommandStatus::FAILED, 0, ErrorCategory::NONE, 0, 0}, {}, {}}; }
+  TransactionAwaiter set(CmdType command, std::vector<byte> values) { return {this, {command}, std::move(values), true, {0, CommandStatus::FAILED, 0, ErrorCategory::NONE, 0, 0}, {}, {}}; }
+
+  CommandAwaiter setPassword(const char *pass) { return command([this, pass] { return _device->startSetPassword(pass); }); }
+  CommandAwaiter setId(const char *id) { return command([this, id] { return _device->startSetId(id); }); }
+  CommandAwaiter scanChannel() { return command([this] { return _device->startScanChannel(); }); }
+  CommandAwaiter getIpv6Address() { return command([this] { return _device->startGetIpv6Address(); }); }
+  CommandAwaiter setChannel() { return command([this] { return _device->startSetChannel(); }); }
+  CommandAwaiter setPanId() { return command([this] { return _device->startSetPanId(); }); }
+  CommandAwaiter requestAndWaitConnection() { return command([this] { return _device->startConnection(); }); }
+  CommandAwaiter command(std::function<bool()> start) { return {this, std::move(start), false, {}}; }
+
+  SleepAwaiter sleep(unsigned long ms) { return {this, ms, {}}; }
+
+  // B ルートの ID・パスワードを設定し、スキャンから PANA 接続までを行う
+  // id・password は完了するまで有効であること
+  CoTask<bool> connect(const char *id, const char *password)
+  {
+    bool succeeded = co_await setPassword(password);
+    if (succeeded)
+      succeeded = co_await setId(id);
+    if (succeeded)
+      succeeded = co_await scanChannel();
+    if (succeeded)
+      succeeded = co_await getIpv6Address();
+    if (succeeded)
+      succeeded = co_await setChannel();
+    if (succeeded)
+      succeeded = co_await setPanId();
+    if (succeeded)
+      succeeded = co_await requestAndWaitConnection();
+    co_return succeeded;
+  }
+
+private:
+  struct Timer
+  {
+    std::coroutine_handle<> handle;
+    unsigned long start;
+    unsigned long duration;
+  };
+
+  // 破棄されたコルーチンを再開しないよう、待ち行列から取り除く
+  void forget(std::coroutine_handle<> handle)
+  {
+    if (!handle)
+    {
+      return;
+    }
+    for (std::deque<std::coroutine_handle<>> *queue : {&_ready, &_resuming})
+    {
+      for (auto it = queue->begin(); it != queue->end();)
+      {
+        it = *it == handle ? queue->erase(it) : it + 1;
+      }
+    }
+    for (auto it = _timers.begin(); it != _timers.end();)
+    {
+      it = it->handle == handle ? _timers.erase(it) : it + 1;
+    }
+  }
+
+  Device *_device;
+  CommandAwaiter *_command = nullptr;            // 完了を待っているコマンド
+  std::deque<std::coroutine_handle<>> _ready;    // 次の poll() で再開するコルーチン
+  std::deque<std::coroutine_handle<>> _resuming; // poll() の中で再開しているコルーチン
+  std::vector<Timer> _timers;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,83 @@
+#include "bp35a1_EchonetFrame.h"
+
+bool ErxudpLine::parse(const LineView &line)
+{
+  // ERXUDP <SENDER> <DEST> <RPORT> <LPORT> <SENDERLLA> <SECURED> [<SIDE>] <DATALEN> <DATA>
+  // バイナリモードでは DATA に空白が含まれうるので、DATALEN までを空白で区切り、残りを DATA とする
+  LineView cols[9];
+  size_t count = 0;
+  const char *p = line.data();
+  const char *end = p + line.size();
+  while (p < end)
+  {
+    const char *start = p;
+    while (p < end && *p != ' ')
+    {
+      ++p;
+    }
+    cols[count] = LineView(start, p - start);
+    if (p < end)
+    {
+      ++p;
+    }
+    // SECURED の後ろの 4 桁の要素が DATALEN
+    if (count >= 7 && cols[count].size() == 4)
+    {
+      dataLength = cols[count];
+      data = LineView(p, end - p);
+      break;
+    }
+    if (++count == 9)
+    {
+      return false;
+    }
+  }
+
+  if (dataLength.empty() || !cols[0].equals("ERXUDP"))
+  {
+    return false;
+  }
+  sender = cols[1];
+  dest = cols[2];
+  rport = cols[3];
+  lport = cols[4];
+  senderLla = cols[5];
+  return true;
+}
+
+size_t ErxudpLine::getDataLength() const
+{
+  byte length[2];
+  if (dataLength.size() != 4 || !HexDecoder::decode(dataLength.data(), length, sizeof(length)))
+  {
+    return 0;
+  }
+  return (length[0] << 8) | length[1];
+}
+
+bool EchonetFrame::parse(const byte *data, size_t size)
+{
+  _data = data;
+  _size = size;
+  _offset = HEADER_SIZE;
+  // EHD は 0x1081 (ECHONET Lite 規格・電文形式1)のみ対応
+  return size >= HEADER_SIZE && data[0] == 0x10 && data[1] == 0x81;
+}
+
+bool EchonetFrame::nextProperty(EchonetProperty *property)
+{
+  if (remaining() < 2)
+  {
+    return false;
+  }
+  byte pdc = _data[_offset + 1];
+  if (remaining() < static_cast<size_t>(2 + pdc))
+  {
+    return false;
+  }
+  property->epc = _data[_offset];
+  property->pdc = pdc;
+  property->edt = _data + _offset + 2;
+  _offset += 2 + pdc;
+  return true;
+}
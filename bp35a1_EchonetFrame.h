@@ -0,0 +1,60 @@
+#ifndef BP35A1_ECHONET_FRAME_H_
+#define BP35A1_ECHONET_FRAME_H_
+
+#include "bp35a1_Platform.h"
+
+#include "bp35a1_Hex.h"
+#include "bp35a1_LineBuffer.h"
+
+// ERXUDP で受信する ECHONET Lite フレームの最大サイズ(バイト)
+#ifndef BP35A1_FRAME_BUFFER_SIZE
+#define BP35A1_FRAME_BUFFER_SIZE (BP35A1_RX_BUFFER_SIZE / 2)
+#endif
+
+// ERXUDP 行の各要素。すべて受信バッファ内を指すビュー
+struct ErxudpLine
+{
+  LineView sender;     // 送信元 IPv6 アドレス
+  LineView dest;       // 送信先 IPv6 アドレス
+  LineView rport;      // 送信元ポート番号
+  LineView lport;      // 送信先ポート番号
+  LineView senderLla;  // 送信元 MAC アドレス
+  LineView dataLength; // データ長
+  LineView data;       // データ
+
+  bool parse(const LineView &line);
+  size_t getDataLength() const; // DATALEN の値(バイト)
+};
+
+// ECHONET Lite プロパティ。edt は受信フレーム内を指す
+struct EchonetProperty
+{
+  byte epc; // プロパティコード
+  byte pdc; // EDT のバイト数
+  const byte *edt;
+};
+
+// ECHONET Lite フレーム(形式1)をコピーせずに先頭から順に読み出す
+class EchonetFrame
+{
+public:
+  static const size_t HEADER_SIZE = 12; // EHD(2) + TID(2) + SEOJ(3) + DEOJ(3) + ESV(1) + OPC(1)
+
+  bool parse(const byte *data, size_t size);
+
+  uint16_t getTid() const { return (_data[2] << 8) | _data[3]; }
+  const byte *getSeoj() const { return _data + 4; }
+  const byte *getDeoj() const { return _data + 7; }
+  byte getEsv() const { return _data[10]; }
+  byte getOpc() const { return _data[11]; }
+
+  bool nextProperty(EchonetProperty *property); // 次のプロパティを読み出す。フレームが足りなければ false
+  size_t remaining() const { return _size - _offset; }
+
+private:
+  const byte *_data = nullptr;
+  size_t _size = 0;
+  size_t _offset = 0;
+};
+
+#endif
@@ -0,0 +1,91 @@
+#include "bp35a1_Hex.h"
+
+#include <cstring>
+
+namespace
+{
+  constexpr byte nibble(int c)
+  {
+    return (c >= '0' && c <= '9')   ? c - '0'
+           : (c >= 'A' && c <= 'F') ? c - 'A' + 10
+           : (c >= 'a' && c <= 'f') ? c - 'a' + 10
+                                    : HexDecoder::INVALID;
+  }
+
+#if BP35A1_HEX_SWAR
+  const uint64_t ONES = 0x0101010101010101ULL;
+  const uint64_t HIGH_BITS = 0x8080808080808080ULL;
+
+  // 8 文字を 4 バイトにデコードする。16 進数以外の文字を含む場合は false
+  inline bool decode8(const char *hex, byte *out)
+  {
+    uint64_t v;
+    memcpy(&v, hex, sizeof(v));
+
+    // '0'~'9' と 'A'~'F' / 'a'~'f' の範囲判定をレーンごとに行う
+    uint64_t digit = v ^ (0x30 * ONES);
+    uint64_t isDigit = ~(digit + (0x80 - 10) * ONES);
+    uint64_t lower = v | (0x20 * ONES);
+    uint64_t isLetter = (lower + (0x80 - 'a') * ONES) & ~(lower + (0x7F - 'f') * ONES);
+    if ((v & HIGH_BITS) != 0 || ((isDigit | isLetter) & HIGH_BITS) != HIGH_BITS)
+    {
+      return false;
+    }
+
+    // 文字 -> 値: 下位 4 ビット + 英字なら 9
+    uint64_t value = (v & (0x0F * ONES)) + ((v >> 6) & ONES) * 9;
+    // 2 文字を 1 バイトにまとめ、偶数レーンを詰める
+    value = ((value & 0x00FF00FF00FF00FFULL) << 4) | ((value >> 8) & 0x00FF00FF00FF00FFULL);
+    value = (value | (value >> 8)) & 0x0000FFFF0000FFFFULL;
+    value = (value | (value >> 16)) & 0x00000000FFFFFFFFULL;
+
+    uint32_t packed = static_cast<uint32_t>(value);
+    memcpy(out, &packed, sizeof(packed));
+    return true;
+  }
+#endif
+}
+
+#define BP35A1_HEX_ROW(base)                                                                   \
+  nibble(base + 0x0), nibble(base + 0x1), nibble(base + 0x2), nibble(base + 0x3),              \
+      nibble(base + 0x4), nibble(base + 0x5), nibble(base + 0x6), nibble(base + 0x7),          \
+      nibble(base + 0x8), nibble(base + 0x9), nibble(base + 0xA), nibble(base + 0xB),          \
+      nibble(base + 0xC), nibble(base + 0xD), nibble(base + 0xE), nibble(base + 0xF)
+
+const byte HexDecoder::TABLE[256] = {
+    BP35A1_HEX_ROW(0x00), BP35A1_HEX_ROW(0x10), BP35A1_HEX_ROW(0x20), BP35A1_HEX_ROW(0x30),
+    BP35A1_HEX_ROW(0x40), BP35A1_HEX_ROW(0x50), BP35A1_HEX_ROW(0x60), BP35A1_HEX_ROW(0x70),
+    BP35A1_HEX_ROW(0x80), BP35A1_HEX_ROW(0x90), BP35A1_HEX_ROW(0xA0), BP35A1_HEX_ROW(0xB0),
+    BP35A1_HEX_ROW(0xC0), BP35A1_HEX_ROW(0xD0), BP35A1_HEX_ROW(0xE0), BP35A1_HEX_ROW(0xF0)};
+
+#undef BP35A1_HEX_ROW
+
+bool HexDecoder::decode(const char *hex, byte *out, size_t size)
+{
+  size_t i = 0;
+#if BP35A1_HEX_SWAR
+  // 読み込み位置は常に書き込み位置より後ろにあるので、hex と out が同じ領域でも壊れない
+  for (; i + 8 <= size; i += 8)
+  {
+    if (!decode8(hex + i * 2, out + i) || !decode8(hex + i * 2 + 8, out + i + 4))
+    {
+      return false;
+    }
+  }
+#endif
+  return decodeScalar(hex + i * 2, out + i, size - i);
+}
+
+bool HexDecoder::decodeScalar(const char *hex, byte *out, size_t size)
+{
+  const unsigned char *in = reinterpret_cast<const unsigned char *>(hex);
+  byte invalid = 0;
+  for (size_t i = 0; i < size; i++)
+  {
+    byte high = TABLE[in[i * 2]];
+    byte low = TABLE[in[i * 2 + 1]];
+    invalid |= high | low;
+    out[i] = static_cast<byte>((high << 4) | (low & 0x0F));
+  }
+  return (invalid & INVALID) == 0;
+}
@@ -0,0 +1,30 @@
+#ifndef BP35A1_HEX_H_
+#define BP35A1_HEX_H_
+
+#include "bp35a1_Platform.h"
+
+// 1 を定義すると 16 文字(8 バイト)ずつまとめてデコードする。リトルエンディアンのみ対応
+#ifndef BP35A1_HEX_SWAR
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define BP35A1_HEX_SWAR 1
+#else
+#define BP35A1_HEX_SWAR 0
+#endif
+#endif
+
+// 16 進文字列をバイト列に変換する
+// 16 進数以外の文字を含む場合は false を返す
+class HexDecoder
+{
+public:
+  // hex の先頭 size * 2 文字を out に size バイトとしてデコードする。hex と out は同じ領域でもよい
+  static bool decode(const char *hex, byte *out, size_t size);
+
+  // テーブル引きのみでデコードする
+  static bool decodeScalar(const char *hex, byte *out, size_t size);
+
+  static const byte INVALID = 0x80;
+  static const byte TABLE[256]; // 文字 -> 値(0~15)。16 進数以外は INVALID
+};
+
+#endif
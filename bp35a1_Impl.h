@@ -0,0 +1,2280 @@
+#ifndef BP35A1_IMPL_H_
+#define BP35A1_IMPL_H_
+
+// BasicBP35A1 のメンバ関数の定義。bp35a1.h から読み込まれる
+// 既定の組み合わせは bp35a1.cpp で明示的に実体化し、それ以外は使う側で実体化される
+
+#include "bp35a1.h"
+
+template <typename Transport, typename Clock>
+const std::string BasicBP35A1<Transport, Clock>::SMART_METER_ID = "028801";
+template <typename Transport, typename Clock>
+const byte BasicBP35A1<Transport, Clock>::SMART_METER_EOJ[3] = {0x02, 0x88, 0x01};
+
+template <typename Transport, typename Clock>
+BasicBP35A1<Transport, Clock>::BasicBP35A1(Transport *serial, ErxudpFormat format)
+    : _serial(serial), _erxudpFormat(format)
+{
+  _rxBuffer.setBinaryPayload(format == ErxudpFormat::BINARY);
+}
+
+template <typename Transport, typename Clock>
+void BasicBP35A1<Transport, Clock>::setEchoCallback(bool isEnable)
+{
+  debugLog("BP35A1::send [SKSREG SFE %d]\r\n", isEnable);
+  _serial->printf("SKSREG SFE %d\r\n", isEnable);
+  clearBuffer();
+}
+
+template <typename Transport, typename Clock>
+void BasicBP35A1<Transport, Clock>::deleteSession()
+{
+  debugLog("BP35A1::send [SKTERM]\r\n");
+  _serial->print("SKTERM\r\n");
+  clearBuffer();
+  _panaSessionLifetime = 86400;
+  _isAuthenticated = false;
+  _reauthPending = false;
+  _reauthState = ReauthState::NONE;
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::getVersion()
+{
+  bool status = startGetVersion() && waitForCompletion();
+  clearBuffer();
+  return status;
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::getAsciiMode()
+{
+  return startGetAsciiMode() && waitForCompletion();
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::assureAsciiMode()
+{
+  if (getAsciiMode())
+  {
+    return true;
+  }
+  else
+  {
+    return setAsciiMode(true);
+  }
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::assureErxudpFormat()
+{
+  if (startGetErxudpFormat() && waitForCompletion())
+  {
+    return true;
+  }
+  return setAsciiMode(_erxudpFormat == ErxudpFormat::ASCII);
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::setPassword(const char *pass)
+{
+  return trySetPassword(pass).ok();
+}
+
+template <typename Transport, typename Clock>
+CommandResult BasicBP35A1<Transport, Clock>::trySetPassword(const char *pass)
+{
+  return runCommand(startSetPassword(pass));
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::setId(const char *id)
+{
+  return trySetId(id).ok();
+}
+
+template <typename Transport, typename Clock>
+CommandResult BasicBP35A1<Transport, Clock>::trySetId(const char *id)
+{
+  return runCommand(startSetId(id));
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::getIpv6Address()
+{
+  return tryGetIpv6Address().ok();
+}
+
+template <typename Transport, typename Clock>
+CommandResult BasicBP35A1<Transport, Clock>::tryGetIpv6Address()
+{
+  return runCommand(startGetIpv6Address());
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::setChannel()
+{
+  return trySetChannel().ok();
+}
+
+template <typename Transport, typename Clock>
+CommandResult BasicBP35A1<Transport, Clock>::trySetChannel()
+{
+  return runCommand(startSetChannel());
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::setPanId()
+{
+  return trySetPanId().ok();
+}
+
+template <typename Transport, typename Clock>
+CommandResult BasicBP35A1<Transport, Clock>::trySetPanId()
+{
+  return runCommand(startSetPanId());
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::setSessionLifetime(unsigned int seconds)
+{
+  return trySetSessionLifetime(seconds).ok();
+}
+
+template <typename Transport, typename Clock>
+CommandResult BasicBP35A1<Transport, Clock>::trySetSessionLifetime(unsigned int seconds)
+{
+  return runCommand(startSetSessionLifetime(seconds));
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::requestAndWaitConnection()
+{
+  return tryRequestAndWaitConnection().ok();
+}
+
+template <typename Transport, typename Clock>
+CommandResult BasicBP35A1<Transport, Clock>::tryRequestAndWaitConnection()
+{
+  return runCommand(startConnection());
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::reauthenticate()
+{
+  return tryReauthenticate().ok();
+}
+
+template <typename Transport, typename Clock>
+CommandResult BasicBP35A1<Transport, Clock>::tryReauthenticate()
+{
+  return runCommand(startReauthentication());
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::connect(const char *id, const char *password, ConnectionStore *store)
+{
+  return tryConnect(id, password, store).ok();
+}
+
+template <typename Transport, typename Clock>
+CommandResult BasicBP35A1<Transport, Clock>::tryConnect(const char *id, const char *password, ConnectionStore *store)
+{
+  unsigned long started = Clock::now();
+  CommandResult result = {ErrorCategory::NONE, 0, 0, 0, 0};
+  if (!assureErxudpFormat())
+  {
+    // ROPT / WOPT の結果。開始できなかった場合はその原因
+    result = _startError != ErrorCategory::NONE ? CommandResult{_startError, 0, 0, 0, 0} : _commandResult;
+    _lastResult = result;
+    return result;
+  }
+  if (!(result = trySetPassword(password)) || !(result = trySetId(id)))
+  {
+    return result;
+  }
+  if (store == nullptr || !restoreConnection(store))
+  {
+    if (!(result = tryScanChannel()) || !(result = tryGetIpv6Address()) || !(result = trySetChannel()) ||
+        !(result = trySetPanId()) || !(result = tryRequestAndWaitConnection()))
+    {
+      return result;
+    }
+    if (store != nullptr && !saveConnection(store))
+    {
+      log_w("BP35A1::connect(): Cannot save connection");
+    }
+  }
+  // 成功したときは接続全体にかかった時間を返す
+  result = {ErrorCategory::NONE, 0, 0, Clock::now() - started, 0};
+  _lastResult = result;
+  return result;
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::restoreConnection(ConnectionStore *store)
+{
+  ConnectionInfo info;
+  if (!store->load(&info))
+  {
+    return false;
+  }
+  log_d("BP35A1::restoreConnection(): Channel %s, Pan ID %s", info.scanResult.channel.c_str(), info.scanResult.panId.c_str());
+  _scanResult = info.scanResult;
+  _ipv6 = info.ipv6;
+  if (setChannel() && setPanId() && requestAndWaitConnection())
+  {
+    return true;
+  }
+  // メーターの PAN が変わった可能性がある。呼び出し側でスキャンからやり直す
+  log_w("BP35A1::restoreConnection(): Cannot join the saved PAN");
+  return false;
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::saveConnection(ConnectionStore *store) const
+{
+  return store->save(getConnectionInfo());
+}
+
+template <typename Transport, typename Clock>
+ConnectionInfo BasicBP35A1<Transport, Clock>::getConnectionInfo() const
+{
+  ConnectionInfo info;
+  info.scanResult = _scanResult;
+  info.ipv6 = _ipv6;
+  return info;
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::startGetVersion()
+{
+  if (!startCommand(CommandState::WAIT_OK, READ_TIMEOUT))
+    return false;
+
+  debugLog("BP35A1::send [SKVER]\r\n");
+  _serial->print("SKVER\r\n");
+  return true;
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::startGetAsciiMode()
+{
+  return startGetOutputMode("OK 01");
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::startGetErxudpFormat()
+{
+  return startGetOutputMode(_erxudpFormat == ErxudpFormat::ASCII ? "OK 01" : "OK 00");
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::startSetErxudpFormat()
+{
+  return startSetAsciiMode(_erxudpFormat == ErxudpFormat::ASCII);
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::startGetOutputMode(const char *expected)
+{
+  if (!startCommand(CommandState::WAIT_ROPT, READ_TIMEOUT))
+    return false;
+
+  _expectedOutputMode = expected;
+  debugLog("BP35A1::send [ROPT]\r\n");
+  _serial->print("ROPT\r\n");
+  return true;
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::startSetPassword(const char *pass)
+{
+  if (!startCommand(CommandState::WAIT_OK, READ_TIMEOUT))
+    return false;
+
+  debugLog("BP35A1::send [SKSETPWD C <password>]\r\n");
+  _serial->printf("SKSETPWD C %s\r\n", pass);
+  return true;
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::startSetId(const char *id)
+{
+  if (!startCommand(CommandState::WAIT_OK, READ_TIMEOUT))
+    return false;
+
+  // スキャン結果の Pairing ID と照合する
+  size_t length = strlen(id);
+  strncpy(_pairId, id + (length > 8 ? length - 8 : 0), 8);
+  _pairId[8] = '\0';
+
+  debugLog("BP35A1::send [SKSETRBID <id>]\r\n");
+  _serial->printf("SKSETRBID %s\r\n", id);
+  return true;
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::startScanChannel(uint32_t channelMask, int duration)
+{
+  if (channelMask == 0 || duration < 1 || duration > SCAN_MAX_DURATION)
+  {
+    log_e("BP35A1::startScanChannel(): Invalid mask or duration");
+    _startError = ErrorCategory::INVALID_ARGUMENT;
+    return false;
+  }
+  if (!startCommand(CommandState::WAIT_SCAN_OK, READ_TIMEOUT))
+    return false;
+
+  // duration: duration~9 でスキャン
+  _scanChannelMask = channelMask;
+  _scanDuration = duration;
+  sendScan();
+  return true;
+}
+
+template <typename Transport, typename Clock>
+uint32_t BasicBP35A1<Transport, Clock>::getChannelMask(const char *channel)
+{
+  // ビット 0 がチャンネル 33(0x21)、ビット 27 がチャンネル 60(0x3C)
+  byte number = 0;
+  if (strlen(channel) != 2 || !HexDecoder::decode(channel, &number, 1) || number < 33 || number > 60)
+  {
+    return 0;
+  }
+  return 1UL << (number - 33);
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::startGetIpv6Address()
+{
+  if (_scanResult.addr == "")
+  {
+    _startError = ErrorCategory::INVALID_ARGUMENT;
+    return false;
+  }
+  if (!startCommand(CommandState::WAIT_IPV6_ADDR, READ_TIMEOUT))
+    return false;
+
+  auto addr = _scanResult.addr.c_str();
+  debugLog("BP35A1::send [SKLL64 <%s>]\r\n", addr);
+  _serial->printf("SKLL64 %s\r\n", addr);
+  return true;
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::startSetChannel()
+{
+  if (_scanResult.channel == "")
+  {
+    _startError = ErrorCategory::INVALID_ARGUMENT;
+    return false;
+  }
+  if (!startCommand(CommandState::WAIT_OK, READ_TIMEOUT))
+    return false;
+
+  auto channel = _scanResult.channel.c_str();
+  debugLog("BP35A1::send [SKSREG S2 <%s>]\r\n", channel);
+  _serial->printf("SKSREG S2 %s\r\n", channel);
+  return true;
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::startSetPanId()
+{
+  if (_scanResult.panId == "")
+  {
+    _startError = ErrorCategory::INVALID_ARGUMENT;
+    return false;
+  }
+  if (!startCommand(CommandState::WAIT_OK, READ_TIMEOUT))
+    return false;
+
+  auto panId = _scanResult.panId.c_str();
+  debugLog("BP35A1::send [SKSREG S3 <%s>]\r\n", panId);
+  _serial->printf("SKSREG S3 %s\r\n", panId);
+  return true;
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::startSetSessionLifetime(unsigned int seconds)
+{
+  if (!startCommand(CommandState::WAIT_LIFETIME_OK, READ_TIMEOUT))
+    return false;
+
+  _requestedSessionLifetime = seconds;
+  debugLog("BP35A1::send [SKSREG S16 <%08X>]\r\n", seconds);
+  _serial->printf("SKSREG S16 %08X\r\n", seconds);
+  return true;
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::startConnection()
+{
+  if (!startCommand(CommandState::WAIT_JOIN_OK, READ_TIMEOUT))
+    return false;
+
+  auto ipv6 = _ipv6.c_str();
+  debugLog("BP35A1::send [SKJOIN <%s>]", ipv6);
+  _serial->printf("SKJOIN %s\r\n", ipv6);
+  return true;
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::startReauthentication()
+{
+  if (!_isAuthenticated)
+  {
+    log_e("BP35A1::startReauthentication(): Not connected");
+    _startError = ErrorCategory::NOT_CONNECTED;
+    return false;
+  }
+  if (!startCommand(CommandState::WAIT_JOIN_OK, READ_TIMEOUT))
+    return false;
+
+  // SKREJOIN の応答は SKJOIN と同じく OK と EVENT 25 / EVENT 24
+  debugLog("BP35A1::send [SKREJOIN]\r\n");
+  _serial->print("SKREJOIN\r\n");
+  return true;
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::requestCoefficient()
+{
+  return getProperties({CmdType::COEFFICIENT});
+}
+
+#ifndef BP35A1_DISABLE_EPC_E0
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::requestTotalPower()
+{
+  return getProperties({CmdType::TOTAL_POWER});
+}
+#endif
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::requestPowerUnit()
+{
+  return getProperties({CmdType::POWER_UNIT});
+}
+
+#ifndef BP35A1_DISABLE_EPC_E2
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::requestCurrentTotalPowerHistories()
+{
+  return getProperties({CmdType::TOTAL_POWER_HISTORIES});
+}
+#endif
+
+#ifndef BP35A1_DISABLE_EPC_E5
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::requestTotalHistoryCollectionDate()
+{
+  return getProperties({CmdType::TOTAL_HISTORY_COLLECTION_DATE});
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::setTotalHistoryCollectionDate(byte day)
+{
+  return setProperties(CmdType::TOTAL_HISTORY_COLLECTION_DATE, {day});
+}
+#endif
+
+#ifndef BP35A1_DISABLE_EPC_E7
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::requestInstantaneousPower()
+{
+  return getProperties({CmdType::INSTANTANEOUS_POWER});
+}
+#endif
+
+#ifndef BP35A1_DISABLE_EPC_E8
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::requestInstantaneousAmperage()
+{
+  return getProperties({CmdType::INSTANTANEOUS_AMPERAGE});
+}
+#endif
+
+#ifndef BP35A1_DISABLE_EPC_EA
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::requestCurrentTotalPower()
+{
+  return getProperties({CmdType::CURRENT_TOTAL_POWER});
+}
+#endif
+
+#ifndef BP35A1_DISABLE_EPC_C0
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::requestBRouteId()
+{
+  return getProperties({CmdType::B_ROUTE_ID});
+}
+#endif
+
+#ifndef BP35A1_DISABLE_EPC_D0
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::requestOneMinuteTotalPower()
+{
+  return getProperties({CmdType::ONE_MINUTE_TOTAL_POWER});
+}
+#endif
+
+#ifndef BP35A1_DISABLE_EPC_D7
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::requestEffectiveDigits()
+{
+  return getProperties({CmdType::EFFECTIVE_DIGITS});
+}
+#endif
+
+#ifndef BP35A1_DISABLE_EPC_E3
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::requestReverseTotalPower()
+{
+  return getProperties({CmdType::TOTAL_POWER_REVERSE});
+}
+#endif
+
+#ifndef BP35A1_DISABLE_EPC_E4
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::requestReverseTotalPowerHistories()
+{
+  return getProperties({CmdType::TOTAL_POWER_HISTORIES_REVERSE});
+}
+#endif
+
+#ifndef BP35A1_DISABLE_EPC_EB
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::requestReverseCurrentTotalPower()
+{
+  return getProperties({CmdType::CURRENT_TOTAL_POWER_REVERSE});
+}
+#endif
+
+#ifndef BP35A1_DISABLE_EPC_EE
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::requestTotalPowerHistories3()
+{
+  return getProperties({CmdType::TOTAL_POWER_HISTORIES3});
+}
+#endif
+
+#ifndef BP35A1_DISABLE_EPC_EF
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::requestTotalHistoryCollectionDate3()
+{
+  return getProperties({CmdType::TOTAL_HISTORY_COLLECTION_DATE3});
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::setTotalHistoryCollectionDate3(const byte *data)
+{
+  if (!data) {
+    return false;
+  }
+  std::vector<byte> values;
+  values.reserve(7);
+  for (int i = 0; i < 7; ++i) {
+    values.push_back(data[i]);
+  }
+  return setProperties(CmdType::TOTAL_HISTORY_COLLECTION_DATE3, values);
+}
+#endif
+
+template <typename Transport, typename Clock>
+template <typename T, typename Getter>
+uint16_t BasicBP35A1<Transport, Clock>::requestValueAsync(CmdType command, ValueCallback<T> callback, Getter getter)
+{
+  return getPropertiesAsync({command}, [callback, getter](const AsyncResult &result)
+                            {
+                              if (callback)
+                                callback(result, getter());
+                            });
+}
+
+template <typename Transport, typename Clock>
+uint16_t BasicBP35A1<Transport, Clock>::requestCoefficientAsync(ValueCallback<int> callback)
+{
+  return requestValueAsync(CmdType::COEFFICIENT, callback, [this]
+                           { return getCoefficient(); });
+}
+
+template <typename Transport, typename Clock>
+uint16_t BasicBP35A1<Transport, Clock>::requestPowerUnitAsync(ValueCallback<float> callback)
+{
+  return requestValueAsync(CmdType::POWER_UNIT, callback, [this]
+                           { return getPowerUnit(); });
+}
+
+#ifndef BP35A1_DISABLE_EPC_E0
+template <typename Transport, typename Clock>
+uint16_t BasicBP35A1<Transport, Clock>::requestTotalPowerAsync(ValueCallback<float> callback)
+{
+  return requestValueAsync(CmdType::TOTAL_POWER, callback, [this]
+                           { return getTotalPower(); });
+}
+#endif
+
+#ifndef BP35A1_DISABLE_EPC_E5
+template <typename Transport, typename Clock>
+uint16_t BasicBP35A1<Transport, Clock>::requestTotalHistoryCollectionDateAsync(ValueCallback<byte> callback)
+{
+  return requestValueAsync(CmdType::TOTAL_HISTORY_COLLECTION_DATE, callback, [this]
+                           { return getCollectionDay(); });
+}
+#endif
+
+#ifndef BP35A1_DISABLE_EPC_E7
+template <typename Transport, typename Clock>
+uint16_t BasicBP35A1<Transport, Clock>::requestInstantaneousPowerAsync(ValueCallback<int> callback)
+{
+  return requestValueAsync(CmdType::INSTANTANEOUS_POWER, callback, [this]
+                           { return getInstantaneousPower(); });
+}
+#endif
+
+#ifndef BP35A1_DISABLE_EPC_E8
+template <typename Transport, typename Clock>
+uint16_t BasicBP35A1<Transport, Clock>::requestInstantaneousAmperageAsync(ValueCallback<InstantaneousAmperage> callback)
+{
+  return requestValueAsync(CmdType::INSTANTANEOUS_AMPERAGE, callback, [this]
+                           { return getInstantaneousAmperage(); });
+}
+#endif
+
+#ifndef BP35A1_DISABLE_EPC_EA
+template <typename Transport, typename Clock>
+uint16_t BasicBP35A1<Transport, Clock>::requestCurrentTotalPowerAsync(ValueCallback<float> callback)
+{
+  return requestValueAsync(CmdType::CURRENT_TOTAL_POWER, callback, [this]
+                           { return getCurrentTotalPower(); });
+}
+#endif
+
+#ifndef BP35A1_DISABLE_EPC_D7
+template <typename Transport, typename Clock>
+uint16_t BasicBP35A1<Transport, Clock>::requestEffectiveDigitsAsync(ValueCallback<byte> callback)
+{
+  return requestValueAsync(CmdType::EFFECTIVE_DIGITS, callback, [this]
+                           { return getEffectiveDigits(); });
+}
+#endif
+
+#ifndef BP35A1_DISABLE_EPC_E3
+template <typename Transport, typename Clock>
+uint16_t BasicBP35A1<Transport, Clock>::requestReverseTotalPowerAsync(ValueCallback<long> callback)
+{
+  return requestValueAsync(CmdType::TOTAL_POWER_REVERSE, callback, [this]
+                           { return getReverseTotalPower(); });
+}
+#endif
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::getProperties(std::vector<CmdType> commands)
+{
+  return tryGetProperties(commands).ok();
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::setProperties(CmdType command, std::vector<byte> values)
+{
+  return trySetProperties(command, values).ok();
+}
+
+template <typename Transport, typename Clock>
+CommandResult BasicBP35A1<Transport, Clock>::tryGetProperties(std::vector<CmdType> commands)
+{
+  return runTransaction(startGetProperties(commands));
+}
+
+template <typename Transport, typename Clock>
+CommandResult BasicBP35A1<Transport, Clock>::trySetProperties(CmdType command, std::vector<byte> values)
+{
+  return runTransaction(startSetProperties(command, values));
+}
+
+template <typename Transport, typename Clock>
+uint16_t BasicBP35A1<Transport, Clock>::startGetProperties(std::vector<CmdType> commands)
+{
+  return getPropertiesAsync(commands, AsyncCallback());
+}
+
+template <typename Transport, typename Clock>
+uint16_t BasicBP35A1<Transport, Clock>::getPropertiesAsync(std::vector<CmdType> commands, AsyncCallback callback)
+{
+  std::vector<byte> data = {
+      0x10, 0x81,       // EHD ECHONET Lite ヘッダ
+      0x00, 0x00,       // TID トランザクションID(startUdpRequest() で割り当てる)
+      0x05, 0xFF, 0x01, // SEOJ 送信元 ECHONET Lite オブジェクト
+      0x02, 0x88, 0x01, // DEOJ 送信先 ECHONET Lite オブジェクト
+      0x62,             // ESV ECHONET Lite サービス(プロパティ値読み出し要求)
+  };
+  data.push_back(0x00); // OPC 処理プロパティ数
+  for (const auto &cmd : commands)
+  {
+    if (!isGetSupported(cmd))
+    {
+      log_d("BP35A1::getPropertiesAsync(): EPC %02X is not supported, skipped", static_cast<byte>(cmd));
+      continue;
+    }
+    data.push_back(static_cast<byte>(cmd));
+    data.push_back(0x00);
+    data[11]++;
+  }
+  if (data[11] == 0)
+  {
+    log_w("BP35A1::getPropertiesAsync(): No supported property");
+    _startError = ErrorCategory::REJECTED;
+    return 0;
+  }
+  uint16_t tid = startUdpRequest(data, callback);
+  for (size_t i = EchonetFrame::HEADER_SIZE; tid != 0 && i < data.size(); i += 2)
+  {
+    // 以降の fetch*() はこの要求の完了を待つ
+    _propertyCache.assign(static_cast<CmdType>(data[i]), tid);
+  }
+  return tid;
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::fetchProperty(CmdType command)
+{
+  return tryFetchProperty(command).ok();
+}
+
+template <typename Transport, typename Clock>
+CommandResult BasicBP35A1<Transport, Clock>::tryFetchProperty(CmdType command)
+{
+  if (_propertyCache.isFresh(command, Clock::now()))
+  {
+    _lastResult = {ErrorCategory::NONE, 0, 0, 0, 0};
+    return _lastResult;
+  }
+  uint16_t tid = _propertyCache.getPending(command);
+  if (tid == 0)
+  {
+    tid = startGetProperties({command});
+  }
+  runTransaction(tid);
+  if (tid != 0)
+  {
+    // 他の EPC と同じ要求で取得した場合も、このプロパティの値を受信できたかで判定する
+    _lastResult.error = getPropertyError(command, tid, _lastResult.error);
+  }
+  return _lastResult;
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::fetchPropertyAsync(CmdType command, AsyncCallback callback)
+{
+  if (_propertyCache.isFresh(command, Clock::now()))
+  {
+    if (callback)
+    {
+      callback({0, CommandStatus::SUCCEEDED, 0, ErrorCategory::NONE, 0, 0});
+    }
+    return true;
+  }
+  // 要求全体ではなく、このプロパティの値を受信できたかを結果にする
+  AsyncCallback propertyCallback;
+  if (callback)
+  {
+    propertyCallback = [this, command, callback](const AsyncResult &result)
+    {
+      AsyncResult property = result;
+      property.error = getPropertyError(command, result.tid, result.error);
+      property.status = property.error == ErrorCategory::NONE ? CommandStatus::SUCCEEDED : CommandStatus::FAILED;
+      callback(property);
+    };
+  }
+  Transaction *transaction = findTransaction(_propertyCache.getPending(command));
+  if (transaction != nullptr)
+  {
+    // 取得中の要求に相乗りする。先に登録されたコールバックから順に呼ぶ
+    AsyncCallback previous = transaction->callback;
+    transaction->callback = [previous, propertyCallback](const AsyncResult &result)
+    {
+      if (previous)
+      {
+        previous(result);
+      }
+      if (propertyCallback)
+      {
+        propertyCallback(result);
+      }
+    };
+    return true;
+  }
+  return getPropertiesAsync({command}, propertyCallback) != 0;
+}
+
+template <typename Transport, typename Clock>
+uint16_t BasicBP35A1<Transport, Clock>::startSetProperties(CmdType command, std::vector<byte> values)
+{
+  return setPropertiesAsync(command, values, AsyncCallback());
+}
+
+template <typename Transport, typename Clock>
+uint16_t BasicBP35A1<Transport, Clock>::setPropertiesAsync(CmdType command, std::vector<byte> values, AsyncCallback callback)
+{
+  if (!isSetSupported(command))
+  {
+    log_w("BP35A1::setPropertiesAsync(): EPC %02X is not supported", static_cast<byte>(command));
+    _startError = ErrorCategory::REJECTED;
+    return 0;
+  }
+
+  std::vector<byte> data = {
+      0x10, 0x81,       // EHD ECHONET Lite ヘッダ
+      0x00, 0x00,       // TID トランザクションID(startUdpRequest() で割り当てる)
+      0x05, 0xFF, 0x01, // SEOJ 送信元 ECHONET Lite オブジェクト
+      0x02, 0x88, 0x01, // DEOJ 送信先 ECHONET Lite オブジェクト
+      0x61,             // ESV ECHONET Lite サービス(プロパティ値書き込み要求)
+  };
+
+  data.push_back(0x01);                       // OPC 処理プロパティ数
+  data.push_back(static_cast<byte>(command)); // EPC 処理プロパティ
+  data.push_back(static_cast<byte>(values.size())); // PDC Write
+
+  for (const auto &value : values)
+  {
+    data.push_back(value);
+  }
+  return startUdpRequest(data, callback);
+}
+
+template <typename Transport, typename Clock>
+void BasicBP35A1<Transport, Clock>::clearBuffer()
+{
+  Clock::sleep(500);
+  // ヒープを使わないよう、固定長のバッファに読み捨てる
+  char discarded[64];
+  int available;
+  while ((available = _serial->available()) > 0)
+  {
+    size_t length = _serial->readBytes(discarded, std::min(static_cast<size_t>(available), sizeof(discarded) - 1));
+    if (length == 0)
+    {
+      break;
+    }
+#ifdef BP35A1_DEBUG
+    discarded[length] = '\0';
+    debugLog("BP35A1::clearBuffer() - %s\r\n", discarded);
+#endif
+  }
+  _rxBuffer.clear();
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::scanChannel(uint32_t channelMask, int duration)
+{
+  return tryScanChannel(channelMask, duration).ok();
+}
+
+template <typename Transport, typename Clock>
+CommandResult BasicBP35A1<Transport, Clock>::tryScanChannel(uint32_t channelMask, int duration)
+{
+  return runCommand(startScanChannel(channelMask, duration));
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::readReCertificationEvent()
+{
+  // EVENT 29 を受信したときと、有効期限が近づいて再認証を始めたときは poll() の中で完了を待つ
+  poll();
+  bool reauthenticating = _reauthState != ReauthState::NONE;
+  while (_reauthState != ReauthState::NONE)
+  {
+    waitForSerialData<Clock>(_serial, POLL_INTERVAL);
+    poll();
+  }
+  if (_commandState == CommandState::WAIT_JOIN_OK || _commandState == CommandState::WAIT_CONNECTION)
+  {
+    return waitForCompletion();
+  }
+  return !reauthenticating || _isAuthenticated;
+}
+
+template <typename Transport, typename Clock>
+void BasicBP35A1<Transport, Clock>::poll()
+{
+  LineView line;
+  do
+  {
+    _rxBuffer.fill(_serial);
+    while (_rxBuffer.nextLine(&line))
+    {
+      handleLine(line);
+    }
+  } while (_serial->available() > 0);
+
+  if (_commandState != CommandState::NONE && Clock::now() - _stateStartTime >= _stateTimeout)
+  {
+    handleTimeout();
+  }
+  if (_reauthState != ReauthState::NONE && Clock::now() - _reauthStartTime >= CONNECTION_TIMEOUT)
+  {
+    // 有効期限の閾値は過ぎたままなので、次の poll() でやり直す
+    log_w("BP35A1::poll(): Re-authentication timed out");
+    _reauthState = ReauthState::NONE;
+  }
+  processReauthentication();
+  processTransactions();
+  processPollPlan();
+}
+
+template <typename Transport, typename Clock>
+void BasicBP35A1<Transport, Clock>::processReauthentication()
+{
+  if (_reauthPending)
+  {
+    // 送信中・応答待ちの要求がなくなってから再認証する。その間は新しい要求を送らない
+    if (_commandState != CommandState::NONE || _commandStatus == CommandStatus::BUSY)
+    {
+      return;
+    }
+    for (const auto &transaction : _transactions)
+    {
+      if (transaction.state == TransactionState::SENDING || transaction.state == TransactionState::WAITING)
+      {
+        return;
+      }
+    }
+    _reauthPending = false;
+    sendRejoin();
+    return;
+  }
+
+  if (!_isAuthenticated || _reauthThreshold == 0 || _commandState != CommandState::NONE || _reauthState != ReauthState::NONE)
+  {
+    return;
+  }
+  uint64_t threshold = static_cast<uint64_t>(_panaSessionLifetime) * 10 * _reauthThreshold; // ms
+  if (Clock::now() - _lastCertificationTime >= threshold)
+  {
+    log_d("BP35A1::processReauthentication(): PANA session lifetime %u%% elapsed", _reauthThreshold);
+    _reauthPending = true;
+  }
+}
+
+template <typename Transport, typename Clock>
+void BasicBP35A1<Transport, Clock>::sendRejoin()
+{
+  // ユーザーのコマンドとは別に進めるので、start*() は BUSY にならず、コマンドの結果やコールバックも変わらない
+  _reauthState = ReauthState::WAIT_OK;
+  _reauthStartTime = Clock::now();
+  debugLog("BP35A1::send [SKREJOIN]\r\n");
+  _serial->print("SKREJOIN\r\n");
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::handleReauthLine(const LineView &res)
+{
+  if (res.contains("EVENT 29") && _commandState != CommandState::WAIT_UDP_SENT)
+  {
+    // 送信中でなければ、モジュールが始めた再認証の完了をコマンドとは別に待つ
+    log_d("BP35A1::handleReauthLine(): re certification event received");
+    _reauthState = ReauthState::WAIT_CONNECTION;
+    _reauthStartTime = Clock::now();
+    _reauthPending = false;
+    return true;
+  }
+  if (_reauthState == ReauthState::NONE)
+  {
+    return false;
+  }
+  if (_reauthState == ReauthState::WAIT_OK && res.contains("FAIL ER"))
+  {
+    // SKREJOIN はコマンドを実行していないときに送るので、その後の OK / FAIL ER は SKREJOIN のもの
+    log_e("BP35A1::handleReauthLine(): SKREJOIN failed");
+    _reauthState = ReauthState::NONE;
+    return true;
+  }
+  if (_reauthState == ReauthState::WAIT_OK && res.contains("OK"))
+  {
+    _reauthState = ReauthState::WAIT_CONNECTION;
+    return true;
+  }
+  if (res.contains("EVENT 25"))
+  {
+    log_d("BP35A1::handleReauthLine(): re-authentication succeeded");
+    _lastCertificationTime = Clock::now();
+    _isAuthenticated = true;
+    _reauthState = ReauthState::NONE;
+  }
+  else if (res.contains("EVENT 24"))
+  {
+    log_e("BP35A1::handleReauthLine(): re-authentication failed");
+    _isAuthenticated = false;
+    _reauthState = ReauthState::NONE;
+  }
+  // EVENT 25 / EVENT 24 は送信中の要求も待っているのでコマンドにも渡す
+  return false;
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::startCommand(CommandState state, unsigned long timeout)
+{
+  if (_commandStatus == CommandStatus::BUSY || _commandState != CommandState::NONE)
+  {
+    log_w("BP35A1::startCommand(): another command is in progress");
+    _startError = ErrorCategory::BUSY;
+    return false;
+  }
+  _commandStatus = CommandStatus::BUSY;
+  _isReceived = false;
+  _startError = ErrorCategory::NONE;
+  _commandStarted = Clock::now();
+  _commandRetries = 0;
+  _event21Status = 0;
+  enterState(state, timeout);
+  return true;
+}
+
+template <typename Transport, typename Clock>
+void BasicBP35A1<Transport, Clock>::enterState(CommandState state, unsigned long timeout)
+{
+  _commandState = state;
+  _stateStartTime = Clock::now();
+  _stateTimeout = timeout;
+}
+
+template <typename Transport, typename Clock>
+void BasicBP35A1<Transport, Clock>::finishCommand(bool success, ErrorCategory error, byte errorCode)
+{
+  _commandState = CommandState::NONE;
+  _commandStatus = success ? CommandStatus::SUCCEEDED : CommandStatus::FAILED;
+  _commandResult = {success ? ErrorCategory::NONE : error, errorCode, _event21Status, Clock::now() - _commandStarted, _commandRetries};
+  if (_completionCallback)
+  {
+    _completionCallback(_commandStatus);
+  }
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::waitForCompletion()
+{
+  while (_commandStatus == CommandStatus::BUSY)
+  {
+    poll();
+    if (_commandStatus == CommandStatus::BUSY)
+    {
+      waitForSerialData<Clock>(_serial, POLL_INTERVAL);
+    }
+  }
+  return _commandStatus == CommandStatus::SUCCEEDED;
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::waitForTransaction(uint16_t tid)
+{
+  while (getTransactionStatus(tid) == CommandStatus::BUSY)
+  {
+    poll();
+    if (getTransactionStatus(tid) == CommandStatus::BUSY)
+    {
+      waitForSerialData<Clock>(_serial, POLL_INTERVAL);
+    }
+  }
+  return getTransactionStatus(tid) == CommandStatus::SUCCEEDED;
+}
+
+template <typename Transport, typename Clock>
+CommandResult BasicBP35A1<Transport, Clock>::runCommand(bool started)
+{
+  if (!started)
+  {
+    _lastResult = {_startError, 0, 0, 0, 0};
+    return _lastResult;
+  }
+  waitForCompletion();
+  _lastResult = _commandResult;
+  return _lastResult;
+}
+
+template <typename Transport, typename Clock>
+CommandResult BasicBP35A1<Transport, Clock>::runTransaction(uint16_t tid)
+{
+  if (tid == 0)
+  {
+    _lastResult = {_startError, 0, 0, 0, 0};
+    return _lastResult;
+  }
+  waitForTransaction(tid);
+  _lastResult = getTransactionResult(tid);
+  return _lastResult;
+}
+
+template <typename Transport, typename Clock>
+byte BasicBP35A1<Transport, Clock>::parseErrorCode(const LineView &res)
+{
+  // FAIL ER04 → 4
+  return static_cast<byte>(strtoul(res.after("FAIL ER").c_str(), nullptr, 10));
+}
+
+template <typename Transport, typename Clock>
+void BasicBP35A1<Transport, Clock>::handleLine(const LineView &res)
+{
+  log_d("BP35A1::handleLine(): received response: %s", res.c_str());
+
+  if (res.contains("ERXUDP"))
+  {
+    // ERXUDP はコマンドの状態に関係なく TID で要求と突き合わせる
+    handleUdpResponse(res);
+    return;
+  }
+  if (res.contains("EVENT 24") || res.contains("EVENT 26") || res.contains("EVENT 27") || res.contains("EVENT 28"))
+  {
+    // 接続の失敗・セッションの終了・有効期限切れ。待っているコマンドがあればそちらでも処理する
+    log_w("BP35A1::handleLine(): PANA session lost");
+    _isAuthenticated = false;
+  }
+  if (handleReauthLine(res))
+  {
+    return;
+  }
+
+  switch (_commandState)
+  {
+  case CommandState::WAIT_OK:
+  case CommandState::WAIT_LIFETIME_OK:
+  case CommandState::WAIT_SCAN_OK:
+  case CommandState::WAIT_JOIN_OK:
+    if (res.contains("FAIL ER"))
+    {
+      log_e("BP35A1::handleLine(): error response received");
+      finishCommand(false, ErrorCategory::COMMAND_ERROR, parseErrorCode(res));
+    }
+    else if (res.contains("OK"))
+    {
+      if (_commandState == CommandState::WAIT_SCAN_OK)
+      {
+        _isReceived = false;
+        _scanCandidates.clear();
+        enterState(CommandState::WAIT_SCAN_RESULT, _scanDuration * READ_TIMEOUT);
+      }
+      else if (_commandState == CommandState::WAIT_JOIN_OK)
+      {
+        enterState(CommandState::WAIT_CONNECTION, CONNECTION_TIMEOUT);
+      }
+      else
+      {
+        if (_commandState == CommandState::WAIT_LIFETIME_OK)
+        {
+          _panaSessionLifetime = _requestedSessionLifetime;
+        }
+        finishCommand(true);
+      }
+    }
+    break;
+
+  case CommandState::WAIT_ROPT:
+    finishCommand(res.contains(_expectedOutputMode), ErrorCategory::INVALID_RESPONSE);
+    break;
+
+  case CommandState::WAIT_IPV6_ADDR:
+    if (validateIpv6Format(res))
+    {
+      _ipv6 = res.c_str();
+      finishCommand(true);
+    }
+    break;
+
+  case CommandState::WAIT_SCAN_RESULT:
+    handleScanLine(res);
+    break;
+
+  case CommandState::WAIT_CONNECTION:
+  case CommandState::WAIT_UDP_REAUTH:
+    if (res.contains("EVENT 25"))
+    {
+      log_d("BP35A1::connection succeeded");
+      _lastCertificationTime = Clock::now();
+      _isAuthenticated = true;
+      _reauthPending = false; // モジュールが先に再認証した
+      if (_commandState == CommandState::WAIT_UDP_REAUTH)
+      {
+        enterState(CommandState::WAIT_UDP_RESEND, READ_INTERVAL);
+      }
+      else
+      {
+        finishCommand(true);
+      }
+    }
+    else if (res.contains("EVENT 24"))
+    {
+      log_e("BP35A1::connection failed");
+      _isAuthenticated = false;
+      if (_commandState == CommandState::WAIT_UDP_REAUTH)
+      {
+        finishSending(false, ErrorCategory::CONNECTION_FAILED);
+      }
+      else
+      {
+        finishCommand(false, ErrorCategory::CONNECTION_FAILED);
+      }
+    }
+    else if (res.contains("EVENT 21"))
+    {
+      debugLog("BP35A1::now connecting...\r\n");
+      HexDecoder::decode(res.afterLast(' ').c_str(), &_event21Status, 1);
+      _stateStartTime = Clock::now();
+    }
+    break;
+
+  case CommandState::WAIT_UDP_SENT:
+    handleUdpSentLine(res);
+    break;
+
+  default:
+    break;
+  }
+}
+
+template <typename Transport, typename Clock>
+void BasicBP35A1<Transport, Clock>::handleScanLine(const LineView &res)
+{
+  if (res.contains("EVENT 20"))
+  {
+    _isReceived = true;
+  }
+  else if (res.contains("EVENT 22"))
+  {
+    if (_isReceived && selectScanCandidate())
+    {
+      finishCommand(true);
+      return;
+    }
+    log_w("BP35A1::scan result not received");
+    enterState(CommandState::WAIT_SCAN_RETRY, SCAN_RETRY_INTERVAL);
+  }
+  else if (res.contains("EPANDESC"))
+  {
+    // PAN ごとに EPANDESC に続けて Channel / Pan ID / Addr / LQI / PairID が届く
+    if (_scanCandidates.size() < MAX_SCAN_CANDIDATES)
+    {
+      _scanCandidates.push_back(ScanResult());
+    }
+  }
+  else if (_scanCandidates.empty())
+  {
+    return;
+  }
+  else if (res.contains("Channel:"))
+  {
+    _scanCandidates.back().channel = res.after("Channel:").c_str();
+  }
+  else if (res.contains("Pan ID:"))
+  {
+    _scanCandidates.back().panId = res.after("Pan ID:").c_str();
+  }
+  else if (res.contains("Addr:"))
+  {
+    _scanCandidates.back().addr = res.after("Addr:").c_str();
+  }
+  else if (res.contains("LQI:"))
+  {
+    LineView lqi = res.after("LQI:");
+    if (lqi.size() != 2 || !HexDecoder::decode(lqi.c_str(), &_scanCandidates.back().lqi, 1))
+    {
+      _scanCandidates.back().lqi = 0;
+    }
+  }
+  else if (res.contains("PairID:"))
+  {
+    _scanCandidates.back().pairId = res.after("PairID:").c_str();
+  }
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::selectScanCandidate()
+{
+  // 近隣の家のメーターは Pairing ID が異なり接続できないので、ID が一致する PAN を優先する
+  const ScanResult *best = nullptr;
+  bool bestPaired = false;
+  for (const auto &candidate : _scanCandidates)
+  {
+    if (candidate.channel == "" || candidate.panId == "" || candidate.addr == "")
+    {
+      continue;
+    }
+    bool paired = _pairId[0] != '\0' && candidate.pairId == _pairId;
+    if (best == nullptr || (paired && !bestPaired) || (paired == bestPaired && candidate.lqi > best->lqi))
+    {
+      best = &candidate;
+      bestPaired = paired;
+    }
+  }
+  if (best == nullptr)
+  {
+    return false;
+  }
+  if (!bestPaired && _pairId[0] != '\0')
+  {
+    log_w("BP35A1::selectScanCandidate(): No PAN matches the B route ID");
+  }
+  log_d("BP35A1::selectScanCandidate(): Channel %s, Pan ID %s, LQI %u", best->channel.c_str(), best->panId.c_str(), best->lqi);
+  _scanResult = *best;
+  return true;
+}
+
+template <typename Transport, typename Clock>
+void BasicBP35A1<Transport, Clock>::handleUdpSentLine(const LineView &res)
+{
+  if (res.contains("EVENT 02"))
+  {
+    if (_isReceived)
+    {
+      finishSending(true);
+    }
+    else
+    {
+      _isReceived = true;
+    }
+  }
+  else if (res.contains("EVENT 21"))
+  {
+    // レスポンスの最後の要素が送信結果のステータス
+    LineView status = res.afterLast(' ');
+    if (_sendingTransaction != nullptr)
+    {
+      HexDecoder::decode(status.c_str(), &_sendingTransaction->event21Status, 1);
+    }
+    if (status.equals("00"))
+    {
+      log_d("BP35A1::handleUdpSentLine(): UDP data sent");
+    }
+    else if (status.equals("01"))
+    {
+      log_w("BP35A1::handleUdpSentLine(): Failed to send UDP data");
+      _sendFailed = true;
+      _sendFailure = RetryReason::SEND_FAILED;
+    }
+    else if (status.equals("02"))
+    {
+      log_w("BP35A1::handleUdpSentLine(): UDP data is being prepared");
+      _sendFailed = true;
+      _sendFailure = RetryReason::PREPARING;
+    }
+    else
+    {
+      log_e("BP35A1::handleUdpSentLine(): Invalid response format");
+      finishSending(false, ErrorCategory::INVALID_RESPONSE);
+      return;
+    }
+    // 次の SKSENDTO に前回の OK を取り違えないよう、EVENT 21 と OK の両方を待つ
+    if (_isReceived)
+    {
+      completeSending();
+    }
+    else
+    {
+      _isReceived = true;
+    }
+  }
+  else if (res.contains("EVENT 29"))
+  {
+    log_d("BP35A1::handleUdpSentLine(): re certification event received");
+    enterState(CommandState::WAIT_UDP_REAUTH, CONNECTION_TIMEOUT);
+  }
+  else if (res.contains("FAIL ER"))
+  {
+    log_e("BP35A1::handleUdpSentLine(): error response received");
+    finishSending(false, ErrorCategory::COMMAND_ERROR, parseErrorCode(res));
+  }
+  else if (res.contains("OK"))
+  {
+    log_d("BP35A1::handleUdpSentLine(): OK response received");
+    if (_isReceived)
+    {
+      completeSending();
+    }
+    else
+    {
+      _isReceived = true;
+    }
+  }
+}
+
+template <typename Transport, typename Clock>
+void BasicBP35A1<Transport, Clock>::completeSending()
+{
+  if (!_sendFailed)
+  {
+    finishSending(true);
+    return;
+  }
+  Transaction *transaction = _sendingTransaction;
+  _sendingTransaction = nullptr;
+  _commandState = CommandState::NONE;
+  if (transaction != nullptr)
+  {
+    retryTransaction(transaction, _sendFailure);
+  }
+}
+
+template <typename Transport, typename Clock>
+void BasicBP35A1<Transport, Clock>::retryTransaction(Transaction *transaction, RetryReason reason)
+{
+  unsigned long now = Clock::now();
+  byte count = reason == RetryReason::PREPARING ? ++transaction->preparing : ++transaction->attempts;
+  byte limit = reason == RetryReason::PREPARING ? _retryPolicy.maxPreparing : _retryPolicy.maxAttempts;
+  unsigned long delay = _retryPolicy.getDelay(reason, count, RetryPolicy::nextRandom(&_retryRandom));
+  // PREPARING で打ち切った場合も送信できなかったことになる
+  transaction->lastFailure = reason == RetryReason::NO_RESPONSE ? ErrorCategory::NO_RESPONSE : ErrorCategory::SEND_FAILED;
+  if (count >= limit)
+  {
+    log_e("BP35A1::retryTransaction(): TID %04X failed after %u attempts", transaction->tid, count);
+    finishTransaction(transaction, false, transaction->lastFailure);
+    return;
+  }
+  if (_retryPolicy.deadline != 0 && now + delay - transaction->started >= _retryPolicy.deadline)
+  {
+    log_e("BP35A1::retryTransaction(): TID %04X cannot be resent before the deadline", transaction->tid);
+    finishTransaction(transaction, false, ErrorCategory::DEADLINE_EXCEEDED);
+    return;
+  }
+  // 同じ TID で再送するので、遅れて届いた前回の応答もそのまま受け付けられる
+  log_d("BP35A1::retryTransaction(): TID %04X will be resent in %lums", transaction->tid, delay);
+  transaction->state = TransactionState::QUEUED;
+  transaction->time = now + delay;
+}
+
+template <typename Transport, typename Clock>
+void BasicBP35A1<Transport, Clock>::handleTimeout()
+{
+  switch (_commandState)
+  {
+  case CommandState::WAIT_SCAN_RESULT:
+    log_w("BP35A1::scan result not received");
+    enterState(CommandState::WAIT_SCAN_RETRY, SCAN_RETRY_INTERVAL);
+    break;
+
+  case CommandState::WAIT_SCAN_RETRY:
+    if (++_scanDuration > SCAN_MAX_DURATION)
+    {
+      finishCommand(false, ErrorCategory::NOT_FOUND);
+      break;
+    }
+    _commandRetries++;
+    enterState(CommandState::WAIT_SCAN_OK, READ_TIMEOUT);
+    sendScan();
+    break;
+
+  case CommandState::WAIT_UDP_RESEND:
+    if (_sendingTransaction == nullptr)
+    {
+      // 再送する前に応答が届いて完了済み
+      finishSending(true);
+      break;
+    }
+    log_w("BP35A1::sendUdp(): Retrying to send UDP data");
+    sendUdp();
+    break;
+
+  case CommandState::WAIT_UDP_SENT:
+  case CommandState::WAIT_UDP_REAUTH:
+    log_w("BP35A1::handleTimeout(): UDP send timed out");
+    _sendFailed = true;
+    _sendFailure = RetryReason::SEND_FAILED;
+    completeSending();
+    break;
+
+  default:
+    log_w("BP35A1::handleTimeout(): TimeOut");
+    finishCommand(false, ErrorCategory::TIMEOUT);
+    break;
+  }
+}
+
+template <typename Transport, typename Clock>
+void BasicBP35A1<Transport, Clock>::sendScan()
+{
+  debugLog("SKSCAN 2 %08lX %d 0\r\n", static_cast<unsigned long>(_scanChannelMask), _scanDuration);
+  _serial->printf("SKSCAN 2 %08lX %d 0\r\n", static_cast<unsigned long>(_scanChannelMask), _scanDuration);
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::setAsciiMode(bool use_ascii_mode)
+{
+  if (!startSetAsciiMode(use_ascii_mode))
+    return false;
+
+  bool status = waitForCompletion();
+  clearBuffer();
+  return status;
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::startSetAsciiMode(bool use_ascii_mode)
+{
+  if (!startCommand(CommandState::WAIT_OK, READ_TIMEOUT))
+    return false;
+
+  // Don't use WOPT command every start up to protect the flash memory
+  if (use_ascii_mode)
+  {
+    debugLog("BP35A1::send [WOPT] 01\r\n");
+    _serial->print("WOPT 01\r\n");
+  }
+  else
+  {
+    debugLog("BP35A1::send [WOPT] 00\r\n");
+    _serial->print("WOPT 00\r\n");
+  }
+  return true;
+}
+
+template <typename Transport, typename Clock>
+uint16_t BasicBP35A1<Transport, Clock>::startUdpRequest(const std::vector<byte> &data, AsyncCallback callback)
+{
+  if (data.size() > BP35A1_MAX_REQUEST_SIZE)
+  {
+    log_e("BP35A1::startUdpRequest(): Request too long");
+    _startError = ErrorCategory::INVALID_ARGUMENT;
+    return 0;
+  }
+
+  Transaction *transaction = allocateTransaction();
+  if (transaction == nullptr)
+  {
+    log_w("BP35A1::startUdpRequest(): too many pending requests");
+    _startError = ErrorCategory::BUSY;
+    return 0;
+  }
+
+  uint16_t tid = _nextTid;
+  _nextTid = _nextTid == 0xFFFF ? 1 : _nextTid + 1;
+
+  std::copy(data.begin(), data.end(), transaction->frame.begin());
+  transaction->frame[2] = tid >> 8;
+  transaction->frame[3] = tid & 0xFF;
+  transaction->length = data.size();
+  transaction->tid = tid;
+  transaction->attempts = 0;
+  transaction->preparing = 0;
+  transaction->sent = 0;
+  transaction->event21Status = 0;
+  transaction->lastFailure = ErrorCategory::NONE;
+  transaction->time = Clock::now();
+  transaction->started = transaction->time;
+  transaction->callback = callback;
+  transaction->oneWay = false;
+  transaction->state = TransactionState::QUEUED;
+
+  // コマンドを実行していなければすぐに送信する
+  processTransactions();
+  return tid;
+}
+
+template <typename Transport, typename Clock>
+typename BasicBP35A1<Transport, Clock>::Transaction *BasicBP35A1<Transport, Clock>::allocateTransaction()
+{
+  for (auto &transaction : _transactions)
+  {
+    if (transaction.state == TransactionState::FREE)
+    {
+      return &transaction;
+    }
+  }
+  return nullptr;
+}
+
+template <typename Transport, typename Clock>
+typename BasicBP35A1<Transport, Clock>::Transaction *BasicBP35A1<Transport, Clock>::findTransaction(uint16_t tid)
+{
+  for (auto &transaction : _transactions)
+  {
+    if (transaction.state != TransactionState::FREE && !transaction.oneWay && transaction.tid == tid)
+    {
+      return &transaction;
+    }
+  }
+  return nullptr;
+}
+
+template <typename Transport, typename Clock>
+CommandStatus BasicBP35A1<Transport, Clock>::getTransactionStatus(uint16_t tid) const
+{
+  if (tid == 0)
+  {
+    return CommandStatus::IDLE;
+  }
+  for (const auto &transaction : _transactions)
+  {
+    if (transaction.state != TransactionState::FREE && !transaction.oneWay && transaction.tid == tid)
+    {
+      return CommandStatus::BUSY;
+    }
+  }
+  for (const auto &result : _transactionResults)
+  {
+    if (result.tid == tid)
+    {
+      return result.status;
+    }
+  }
+  return CommandStatus::IDLE;
+}
+
+template <typename Transport, typename Clock>
+CommandResult BasicBP35A1<Transport, Clock>::getTransactionResult(uint16_t tid) const
+{
+  CommandStatus status = getTransactionStatus(tid);
+  if (status == CommandStatus::BUSY)
+  {
+    return {ErrorCategory::BUSY, 0, 0, 0, 0};
+  }
+  for (const auto &result : _transactionResults)
+  {
+    if (tid != 0 && result.tid == tid)
+    {
+      return result.result;
+    }
+  }
+  return {ErrorCategory::INVALID_ARGUMENT, 0, 0, 0, 0};
+}
+
+template <typename Transport, typename Clock>
+size_t BasicBP35A1<Transport, Clock>::getPendingTransactionCount() const
+{
+  size_t count = 0;
+  for (const auto &transaction : _transactions)
+  {
+    if (transaction.state != TransactionState::FREE)
+    {
+      count++;
+    }
+  }
+  return count;
+}
+
+template <typename Transport, typename Clock>
+void BasicBP35A1<Transport, Clock>::processTransactions()
+{
+  unsigned long now = Clock::now();
+  bool reauthenticating = _commandState == CommandState::WAIT_CONNECTION || _commandState == CommandState::WAIT_UDP_REAUTH || _reauthState != ReauthState::NONE;
+  Transaction *next = nullptr;
+  for (auto &transaction : _transactions)
+  {
+    if (transaction.state == TransactionState::WAITING && reauthenticating)
+    {
+      // 再認証中は応答が届かないので、待ち時間に数えない
+      transaction.time = now;
+    }
+    if (_retryPolicy.deadline != 0 && (transaction.state == TransactionState::QUEUED || transaction.state == TransactionState::WAITING) &&
+        now - transaction.started >= _retryPolicy.deadline)
+    {
+      log_w("BP35A1::processTransactions(): TID %04X exceeded the deadline", transaction.tid);
+      finishTransaction(&transaction, false, ErrorCategory::DEADLINE_EXCEEDED);
+      continue;
+    }
+    if (transaction.state == TransactionState::WAITING && now - transaction.time >= _retryPolicy.responseTimeout)
+    {
+      log_d("BP35A1::processTransactions(): no UDP response for TID %04X", transaction.tid);
+      retryTransaction(&transaction, RetryReason::NO_RESPONSE);
+      if (transaction.state != TransactionState::QUEUED)
+      {
+        continue;
+      }
+    }
+    if (transaction.state == TransactionState::QUEUED && static_cast<long>(now - transaction.time) >= 0 &&
+        (next == nullptr || static_cast<long>(transaction.time - next->time) < 0))
+    {
+      next = &transaction;
+    }
+  }
+
+  // SKSENDTO は 1 つずつしか実行できないので、コマンドを実行していないときに送信する
+  if (next != nullptr && !_reauthPending && _reauthState == ReauthState::NONE && _commandState == CommandState::NONE && _commandStatus != CommandStatus::BUSY)
+  {
+    _sendingTransaction = next;
+    next->state = TransactionState::SENDING;
+    sendUdp();
+  }
+}
+
+template <typename Transport, typename Clock>
+void BasicBP35A1<Transport, Clock>::finishSending(bool success, ErrorCategory error, byte errorCode)
+{
+  Transaction *transaction = _sendingTransaction;
+  _sendingTransaction = nullptr;
+  _commandState = CommandState::NONE;
+  if (transaction == nullptr)
+  {
+    // SKSENDTO の完了より先に応答が届いて完了済み
+    return;
+  }
+  if (success && transaction->oneWay)
+  {
+    transaction->state = TransactionState::FREE;
+  }
+  else if (success)
+  {
+    transaction->state = TransactionState::WAITING;
+    transaction->time = Clock::now();
+  }
+  else
+  {
+    finishTransaction(transaction, false, error, errorCode);
+  }
+}
+
+template <typename Transport, typename Clock>
+void BasicBP35A1<Transport, Clock>::finishTransaction(Transaction *transaction, bool success, ErrorCategory error, byte errorCode)
+{
+  if (transaction == _sendingTransaction)
+  {
+    _sendingTransaction = nullptr;
+  }
+  if (transaction->oneWay)
+  {
+    // INFC_Res はメーターの TID なので結果を記録しない
+    log_w("BP35A1::finishTransaction(): Cannot send INFC_Res for TID %04X", transaction->tid);
+    transaction->state = TransactionState::FREE;
+    return;
+  }
+  uint16_t tid = transaction->tid;
+  CommandStatus status = success ? CommandStatus::SUCCEEDED : CommandStatus::FAILED;
+  unsigned long now = Clock::now();
+  byte retries = transaction->sent > 0 ? transaction->sent - 1 : 0;
+  CommandResult detail = {success ? ErrorCategory::NONE : error, errorCode, transaction->event21Status, now - transaction->started, retries};
+  AsyncResult result = {tid, status, detail.elapsed, detail.error, retries, detail.event21Status};
+  AsyncCallback callback;
+  std::swap(callback, transaction->callback); // コールバックの中で次の要求に使われてもよいように先に空ける
+  transaction->state = TransactionState::FREE;
+
+  _transactionResults[_nextResult].tid = tid;
+  _transactionResults[_nextResult].status = status;
+  _transactionResults[_nextResult].result = detail;
+  _nextResult = (_nextResult + 1) % _transactionResults.size();
+  _propertyCache.finish(tid);
+
+  _pollPlan.finish(tid, status, now, _pollCallback);
+  if (callback)
+  {
+    callback(result);
+  }
+  if (_transactionCallback)
+  {
+    _transactionCallback(tid, status);
+  }
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::addPollProperty(CmdType command, unsigned long interval)
+{
+  if (!isGetSupported(command))
+  {
+    log_w("BP35A1::addPollProperty(): EPC %02X is not supported", static_cast<byte>(command));
+    return false;
+  }
+  return _pollPlan.add(command, interval, Clock::now());
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::removePollProperty(CmdType command)
+{
+  return _pollPlan.remove(command);
+}
+
+template <typename Transport, typename Clock>
+void BasicBP35A1<Transport, Clock>::clearPollPlan()
+{
+  _pollPlan.clear();
+}
+
+template <typename Transport, typename Clock>
+void BasicBP35A1<Transport, Clock>::clearRejectedProperties()
+{
+  _getRejected.clear();
+  _setRejected.clear();
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::discoverProperties()
+{
+  uint16_t tid = startDiscoverProperties();
+  return tid != 0 && waitForTransaction(tid) && _propertyMaps.getLoaded && _propertyMaps.setLoaded;
+}
+
+template <typename Transport, typename Clock>
+uint16_t BasicBP35A1<Transport, Clock>::startDiscoverProperties()
+{
+  return startGetProperties({CmdType::STATUS_CHANGE_PROPERTY_MAP, CmdType::SET_PROPERTY_MAP, CmdType::GET_PROPERTY_MAP});
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::isGetSupported(CmdType command) const
+{
+  byte epc = static_cast<byte>(command);
+  if (_getRejected.contains(epc))
+  {
+    return false;
+  }
+  // プロパティマップ自体は再取得できるようにマップの内容にかかわらず要求する
+  return !_propertyMaps.getLoaded || PropertyMapCache::isPropertyMap(epc) || _propertyMaps.get.contains(epc);
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::isSetSupported(CmdType command) const
+{
+  byte epc = static_cast<byte>(command);
+  return !_setRejected.contains(epc) && (!_propertyMaps.setLoaded || _propertyMaps.set.contains(epc));
+}
+
+template <typename Transport, typename Clock>
+void BasicBP35A1<Transport, Clock>::finishProperty(uint16_t tid, byte epc, bool success)
+{
+  CmdType command = static_cast<CmdType>(epc);
+  _pollPlan.finish(tid, command, success ? CommandStatus::SUCCEEDED : CommandStatus::FAILED, Clock::now(), _pollCallback);
+  if (isGetRejected(command))
+  {
+    // 拒否されたプロパティは定期取得からも外す
+    _pollPlan.remove(command);
+  }
+}
+
+template <typename Transport, typename Clock>
+ErrorCategory BasicBP35A1<Transport, Clock>::getPropertyError(CmdType command, uint16_t tid, ErrorCategory error) const
+{
+  if (_propertyCache.getTid(command) == tid)
+  {
+    return ErrorCategory::NONE;
+  }
+  if (isGetRejected(command))
+  {
+    return ErrorCategory::REJECTED;
+  }
+  // 要求は成功したが、応答にこのプロパティが含まれていなかった
+  return error != ErrorCategory::NONE ? error : ErrorCategory::INVALID_RESPONSE;
+}
+
+template <typename Transport, typename Clock>
+void BasicBP35A1<Transport, Clock>::processPollPlan()
+{
+  std::vector<CmdType> batch;
+  while (!(batch = _pollPlan.nextBatch(Clock::now(), BP35A1_MAX_REQUEST_SIZE)).empty())
+  {
+    // 登録した後に取得したプロパティマップで対応していないとわかったものは、一度だけ失敗を通知して外す
+    // 残りは getPropertiesAsync() がすべて要求に載せるので、TID を割り当てるのは送信したものだけになる
+    std::vector<CmdType> supported;
+    for (const auto &command : batch)
+    {
+      if (isGetSupported(command))
+      {
+        supported.push_back(command);
+        continue;
+      }
+      log_w("BP35A1::processPollPlan(): EPC %02X is not supported, removed", static_cast<byte>(command));
+      _pollPlan.remove(command);
+      if (_pollCallback)
+      {
+        _pollCallback(command, CommandStatus::FAILED);
+      }
+    }
+    if (supported.empty())
+    {
+      continue;
+    }
+    uint16_t tid = startGetProperties(supported);
+    if (tid == 0)
+    {
+      // 要求の空きがなければ次の poll() で送る
+      break;
+    }
+    _pollPlan.assign(supported, tid);
+  }
+}
+
+template <typename Transport, typename Clock>
+void BasicBP35A1<Transport, Clock>::sendUdp()
+{
+  Transaction *transaction = _sendingTransaction;
+  transaction->sent++;
+  std::stringstream command;
+  command << "SKSENDTO 1 " << _ipv6.c_str() << " 0E1A 1 0 " << std::setw(4) << std::setfill('0') << std::uppercase << std::hex << static_cast<int>(transaction->length) << " ";
+
+  _isReceived = false;
+  _sendFailed = false;
+  enterState(CommandState::WAIT_UDP_SENT, READ_TIMEOUT);
+  _serial->print(command.str().c_str());
+  _serial->write(transaction->frame.data(), transaction->length);
+  _serial->print("\r\n");
+}
+
+template <typename Transport, typename Clock>
+void BasicBP35A1<Transport, Clock>::handleUdpResponse(const LineView &response)
+{
+  ErxudpLine erxudp;
+  if (!erxudp.parse(response))
+  {
+    log_e("BP35A1::handleUdpResponse(): Invalid response format");
+    return;
+  }
+
+  size_t size = erxudp.getDataLength();
+  const byte *data = _rxFrame.data();
+  if (_erxudpFormat == ErxudpFormat::BINARY)
+  {
+    // バイナリモードのデータ部は受信バッファ上でそのまま読む
+    if (erxudp.data.size() != size)
+    {
+      log_e("BP35A1::handleUdpResponse(): Invalid data length");
+      return;
+    }
+    data = reinterpret_cast<const byte *>(erxudp.data.data());
+  }
+  else if (size > _rxFrame.size() || !parseHexBytes(erxudp.data.data(), erxudp.data.size(), _rxFrame.data(), size))
+  {
+    // データ部を受信フレームバッファにデコードする
+    log_e("BP35A1::handleUdpResponse(): Invalid data");
+    return;
+  }
+
+  EchonetFrame frame;
+  if (!frame.parse(data, size))
+  {
+    log_e("BP35A1::handleUdpResponse(): Invalid frame");
+    return;
+  }
+  byte esv = frame.getEsv();
+  if (esv == static_cast<byte>(ResponseType::INF) || esv == static_cast<byte>(ResponseType::INFC))
+  {
+    // 通知は要求と関係なく届く
+    handleUdpNotification(frame);
+    return;
+  }
+  // レスポンスした識別子がスマートメータと一致するか
+  if (memcmp(frame.getSeoj(), SMART_METER_EOJ, sizeof(SMART_METER_EOJ)) != 0)
+  {
+    log_e("BP35A1::handleUdpResponse(): Invalid smart meter ID");
+    return;
+  }
+
+  Transaction *transaction = findTransaction(frame.getTid());
+  if (transaction == nullptr)
+  {
+    // タイムアウトで打ち切った要求への応答などは読み捨てる
+    log_w("BP35A1::handleUdpResponse(): Unknown TID: %04X", frame.getTid());
+    return;
+  }
+
+  byte requestEsv = transaction->frame[10];
+  ResponseType resType = static_cast<ResponseType>(esv);
+  // Get(0x62) には Get_Res(0x72) / Get_SNA(0x52)、SetC(0x61) には Set_Res(0x71) / SetC_SNA(0x51) が対応する
+  // それ以外の ESV は再送しても結果が変わらないので、その場で失敗にする
+  if (esv != requestEsv + 0x10 && esv != requestEsv - 0x10)
+  {
+    log_e("BP35A1::handleUdpResponse(): Not supported ESV: %02X", esv);
+    finishTransaction(transaction, false, ErrorCategory::INVALID_RESPONSE);
+    return;
+  }
+
+  EchonetFrame properties = frame; // 値を公開した後でプロパティごとの完了を通知するために読み直す
+  PropertyMap acceptedMap;
+  bool status = true;
+  bool rejected = false;
+  bool updated = false;
+  for (int i = 0; i < frame.getOpc(); i++)
+  {
+    EchonetProperty property;
+    if (!frame.nextProperty(&property))
+    {
+      log_e("BP35A1::handleUdpResponse(): Invalid data length");
+      if (updated)
+      {
+        publishSnapshot();
+      }
+      finishTransaction(transaction, false, ErrorCategory::INVALID_RESPONSE);
+      return;
+    }
+
+    // 不可応答でも受理されたプロパティの値は保存する
+    bool accepted = false;
+    switch (resType)
+    {
+    case ResponseType::GET_SNA:
+      if (property.pdc == 0)
+      {
+        log_w("BP35A1::handleUdpResponse(): EPC %02X rejected by Get_SNA", property.epc);
+        _getRejected.set(property.epc);
+        rejected = true;
+        break;
+      }
+      // fall through
+    case ResponseType::GET:
+      accepted = handleUdpGetResponse(property);
+      break;
+
+    case ResponseType::SET_SNA:
+      if (property.pdc != 0)
+      {
+        log_w("BP35A1::handleUdpResponse(): EPC %02X rejected by SetC_SNA", property.epc);
+        _setRejected.set(property.epc);
+        rejected = true;
+        break;
+      }
+      // fall through
+    case ResponseType::SET:
+      accepted = handleUdpSetResponse(property);
+      break;
+
+    case ResponseType::INF:
+    case ResponseType::INFC:
+      break; // handleUdpNotification() で処理済み
+    }
+    status = accepted && status;
+    if (accepted)
+    {
+      acceptedMap.set(property.epc);
+    }
+    if (accepted && property.pdc != 0)
+    {
+      _propertyCache.update(property.epc, transaction->tid, Clock::now());
+      updated = true;
+    }
+  }
+
+  // 同じフレームの値(係数と積算電力量など)をまとめて公開してから、コールバックを呼び出す
+  if (updated)
+  {
+    publishSnapshot();
+  }
+  EchonetProperty property;
+  for (int i = 0; i < frame.getOpc() && properties.nextProperty(&property); i++)
+  {
+    finishProperty(transaction->tid, property.epc, acceptedMap.contains(property.epc));
+  }
+  finishTransaction(transaction, status && frame.remaining() == 0, rejected ? ErrorCategory::REJECTED : ErrorCategory::INVALID_RESPONSE);
+}
+
+template <typename Transport, typename Clock>
+void BasicBP35A1<Transport, Clock>::handleUdpNotification(EchonetFrame frame)
+{
+  if (frame.getEsv() == static_cast<byte>(ResponseType::INFC))
+  {
+    queueInfcResponse(frame);
+  }
+  if (memcmp(frame.getSeoj(), SMART_METER_EOJ, sizeof(SMART_METER_EOJ)) != 0)
+  {
+    // ノードプロファイルのインスタンスリスト通知など
+    log_d("BP35A1::handleUdpNotification(): Notification from %02X%02X%02X ignored", frame.getSeoj()[0], frame.getSeoj()[1], frame.getSeoj()[2]);
+    return;
+  }
+
+  EchonetFrame properties = frame; // 値を公開した後でプロパティごとに通知するために読み直す
+  PropertyMap decodedMap;
+  int count = 0;
+  for (; count < frame.getOpc(); count++)
+  {
+    EchonetProperty property;
+    if (!frame.nextProperty(&property))
+    {
+      log_e("BP35A1::handleUdpNotification(): Invalid data length");
+      break;
+    }
+    if (property.pdc != 0 && handleUdpGetResponse(property))
+    {
+      decodedMap.set(property.epc);
+      _propertyCache.update(property.epc, 0, Clock::now());
+    }
+  }
+
+  if (!decodedMap.empty())
+  {
+    publishSnapshot();
+  }
+  EchonetProperty property;
+  for (int i = 0; i < count && _notificationCallback && properties.nextProperty(&property); i++)
+  {
+    bool decoded = decodedMap.contains(property.epc);
+    _notificationCallback(static_cast<CmdType>(property.epc), decoded ? CommandStatus::SUCCEEDED : CommandStatus::FAILED);
+  }
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::queueInfcResponse(EchonetFrame frame)
+{
+  Transaction *transaction = allocateTransaction();
+  if (transaction == nullptr)
+  {
+    // 応答がなければメーターが INFC を再送する
+    log_w("BP35A1::queueInfcResponse(): too many pending requests");
+    return false;
+  }
+
+  // INFC_Res は TID をそのまま返し、SEOJ と DEOJ を入れ替え、EPC ごとに PDC 0 を並べる
+  auto &data = transaction->frame;
+  data[0] = 0x10;
+  data[1] = 0x81;
+  data[2] = frame.getTid() >> 8;
+  data[3] = frame.getTid() & 0xFF;
+  memcpy(&data[4], frame.getDeoj(), 3);
+  memcpy(&data[7], frame.getSeoj(), 3);
+  data[10] = 0x7A;
+  data[11] = 0;
+  size_t length = EchonetFrame::HEADER_SIZE;
+  EchonetProperty property;
+  for (int i = 0; i < frame.getOpc() && length + 2 <= data.size() && frame.nextProperty(&property); i++)
+  {
+    data[length++] = property.epc;
+    data[length++] = 0;
+    data[11]++;
+  }
+
+  transaction->length = length;
+  transaction->tid = frame.getTid();
+  transaction->attempts = 0;
+  transaction->preparing = 0;
+  transaction->sent = 0;
+  transaction->event21Status = 0;
+  transaction->time = Clock::now();
+  transaction->started = transaction->time;
+  transaction->callback = AsyncCallback();
+  transaction->oneWay = true;
+  transaction->state = TransactionState::QUEUED;
+  processTransactions();
+  return true;
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::handleUdpGetResponse(const EchonetProperty &property)
+{
+  if (PropertyMapCache::isPropertyMap(property.epc))
+  {
+    return _propertyMaps.decode(property);
+  }
+  return PropertyRegistry::decode(&_meterData, property);
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::handleUdpSetResponse(const EchonetProperty &property)
+{
+  // Set_Res の PDC は通常 0。値が返ってきた場合のみ保持する
+  if (property.pdc == 0)
+  {
+    return PropertyRegistry::find(property.epc) != nullptr;
+  }
+  return PropertyRegistry::decode(&_meterData, property);
+}
+
+template <typename Transport, typename Clock>
+void BasicBP35A1<Transport, Clock>::publishSnapshot()
+{
+  MeterSnapshot snapshot = {};
+  snapshot.sequence = _snapshot.getVersion() + 1;
+  snapshot.updatedAt = Clock::now();
+  snapshot.coefficient = getCoefficient();
+  snapshot.powerUnit = getPowerUnit();
+#ifndef BP35A1_DISABLE_EPC_E0
+  snapshot.totalPower = getTotalPower();
+#endif
+#ifndef BP35A1_DISABLE_EPC_E2
+  snapshot.totalPowerHistoriesDay = _meterData.totalPowerHistories.getDay();
+  memcpy(snapshot.totalPowerHistories, _meterData.totalPowerHistories.getPowers(), sizeof(snapshot.totalPowerHistories));
+#endif
+#ifndef BP35A1_DISABLE_EPC_E5
+  snapshot.collectionDay = getCollectionDay();
+#endif
+#ifndef BP35A1_DISABLE_EPC_E7
+  snapshot.instantaneousPower = getInstantaneousPower();
+#endif
+#ifndef BP35A1_DISABLE_EPC_E8
+  snapshot.amperageR = _meterData.instantaneousAmperage.getAmperageR();
+  snapshot.amperageT = _meterData.instantaneousAmperage.getAmperageT();
+#endif
+#ifndef BP35A1_DISABLE_EPC_EA
+  snapshot.currentTotalPower = getCurrentTotalPower();
+#endif
+#ifndef BP35A1_DISABLE_EPC_C0
+  memcpy(snapshot.bRouteId, _meterData.bRouteId.data(), sizeof(snapshot.bRouteId));
+#endif
+#ifndef BP35A1_DISABLE_EPC_D0
+  memcpy(snapshot.oneMinuteTotalPower, _meterData.oneMinuteTotalPower.data(), sizeof(snapshot.oneMinuteTotalPower));
+#endif
+#ifndef BP35A1_DISABLE_EPC_D7
+  snapshot.effectiveDigits = _meterData.effectiveDigits;
+#endif
+#ifndef BP35A1_DISABLE_EPC_E3
+  snapshot.reverseTotalPower = _meterData.reverseTotalPower;
+#endif
+#ifndef BP35A1_DISABLE_EPC_E4
+  memcpy(snapshot.reverseTotalPowerHistories, _meterData.reverseTotalPowerHistories.data(), sizeof(snapshot.reverseTotalPowerHistories));
+#endif
+#ifndef BP35A1_DISABLE_EPC_EB
+  memcpy(snapshot.reverseCurrentTotalPower, _meterData.reverseCurrentTotalPower.data(), sizeof(snapshot.reverseCurrentTotalPower));
+#endif
+#ifndef BP35A1_DISABLE_EPC_EE
+  memcpy(snapshot.totalPowerHistories3, _meterData.totalPowerHistories3.data(), sizeof(snapshot.totalPowerHistories3));
+  snapshot.totalPowerHistories3Length = _meterData.totalPowerHistories3Length;
+#endif
+#ifndef BP35A1_DISABLE_EPC_EF
+  memcpy(snapshot.totalHistoryCollectionDate3, _meterData.totalHistoryCollectionDate3.data(), sizeof(snapshot.totalHistoryCollectionDate3));
+#endif
+  _snapshot.store(snapshot);
+}
+
+template <typename Transport, typename Clock>
+float BasicBP35A1<Transport, Clock>::convertTotalPower(long power)
+{
+  if (power > 99999999 or power < 0)
+  {
+    return 0.0f;
+  }
+  else
+  {
+    return power * getCoefficient() * getPowerUnit();
+  }
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::parseHexBytes(const char *hex, size_t hexLength, byte *out, size_t outSize)
+{
+  if (!out || hexLength < outSize * 2) {
+    return false;
+  }
+  return HexDecoder::decode(hex, out, outSize);
+}
+
+template <typename Transport, typename Clock>
+bool BasicBP35A1<Transport, Clock>::validateIpv6Format(const LineView &ipv6)
+{
+  if (ipv6.size() != 39)
+  {
+    return false;
+  }
+
+  for (size_t i = 0; i < ipv6.size(); i++)
+  {
+    char c = ipv6.data()[i];
+    if (c != ':' && !isxdigit(c))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+template <typename Transport, typename Clock>
+void BasicBP35A1<Transport, Clock>::debugLog(const char *format, ...)
+{
+#ifdef BP35A1_DEBUG
+  va_list args;
+  va_start(args, format);
+  char buf[128];
+  vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+#ifdef ARDUINO
+  Serial.print(buf);
+#else
+  fputs(buf, stderr);
+#endif
+#else
+  (void)format;
+#endif
+}
+
+#endif
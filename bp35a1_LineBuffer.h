@@ -0,0 +1,256 @@
+#ifndef BP35A1_LINE_BUFFER_H_
+#define BP35A1_LINE_BUFFER_H_
+
+#include "bp35a1_Platform.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+// 受信バッファのサイズ(バイト)。ERXUDP の 1 行がこのサイズを超えると破棄される
+#ifndef BP35A1_RX_BUFFER_SIZE
+#define BP35A1_RX_BUFFER_SIZE 1024
+#endif
+
+// 受信バッファ内の 1 行を指す非所有ビュー。次に fill() / clear() するまで有効
+class LineView
+{
+public:
+  LineView() {}
+  LineView(const char *data, size_t size) : _data(data), _size(size) {}
+
+  const char *data() const { return _data; }
+  const char *c_str() const { return _data; } // 行全体と after() / afterLast() のビューは行末が '\0' で終端されている
+  size_t size() const { return _size; }
+  bool empty() const { return _size == 0; }
+
+  bool contains(const char *str) const { return find(str) != nullptr; }
+  bool equals(const char *str) const { return strlen(str) == _size && memcmp(_data, str, _size) == 0; }
+
+  // 最初に現れた prefix の直後から末尾まで
+  LineView after(const char *prefix) const
+  {
+    const char *pos = find(prefix);
+    if (pos == nullptr)
+    {
+      return LineView(_data + _size, 0);
+    }
+    pos += strlen(prefix);
+    return LineView(pos, _data + _size - pos);
+  }
+
+  // 最後に現れた separator の直後から末尾まで
+  LineView afterLast(char separator) const
+  {
+    for (size_t i = _size; i > 0; i--)
+    {
+      if (_data[i - 1] == separator)
+      {
+        return LineView(_data + i, _size - i);
+      }
+    }
+    return LineView(_data + _size, 0);
+  }
+
+private:
+  const char *find(const char *str) const
+  {
+    size_t length = strlen(str);
+    for (size_t i = 0; i + length <= _size; i++)
+    {
+      if (memcmp(_data + i, str, length) == 0)
+      {
+        return _data + i;
+      }
+    }
+    return nullptr;
+  }
+
+  const char *_data = "";
+  size_t _size = 0;
+};
+
+// シリアルから受信したデータを固定長のリングバッファに溜め、CR / LF 区切りの行を取り出す
+// ヒープは使用しない
+template <size_t Capacity>
+class BP35A1LineBuffer
+{
+public:
+  // ERXUDP のデータ部がバイナリの場合、DATALEN バイト分は改行として扱わずに 1 行に含める
+  void setBinaryPayload(bool enabled) { _binaryPayload = enabled; }
+
+  // 受信済みのデータをまとめて読み込む。読み込んだバイト数を返す
+  template <typename Stream>
+  size_t fill(Stream *stream)
+  {
+    size_t total = 0;
+    int available;
+    while (_size < Capacity && (available = stream->available()) > 0)
+    {
+      if (_size == 0)
+      {
+        _head = 0;
+        _scanned = 0;
+      }
+      size_t tail = (_head + _size) % Capacity;
+      size_t space = tail >= _head ? Capacity - tail : _head - tail;
+      size_t length = std::min(static_cast<size_t>(available), space);
+      size_t read = stream->readBytes(_buffer + tail, length);
+      if (read == 0)
+      {
+        break;
+      }
+      _size += read;
+      total += read;
+    }
+    return total;
+  }
+
+  // 空行を除いた次の 1 行を前後の空白を取り除いて返す。行がまだ揃っていなければ false
+  bool nextLine(LineView *line)
+  {
+    while (_scanned < _size)
+    {
+      if (_payloadRemaining > 0)
+      {
+        size_t skip = std::min(_payloadRemaining, _size - _scanned);
+        _scanned += skip;
+        _payloadRemaining -= skip;
+        continue;
+      }
+
+      size_t pos = (_head + _scanned) % Capacity;
+      char c = _buffer[pos];
+      if (c != '\r' && c != '\n')
+      {
+        if (c == ' ' && _binaryPayload && _tokenCount >= 0)
+        {
+          scanErxudpHeader();
+        }
+        ++_scanned;
+        continue;
+      }
+      bool hasPayload = _tokenCount == PAYLOAD_FOUND;
+      _tokenCount = 0;
+      _tokenStart = 0;
+
+      size_t length = _scanned;
+      if (_head + length >= Capacity)
+      {
+        // 行がバッファの末尾をまたぐ場合は先頭に詰め直して連続した領域にする
+        std::rotate(_buffer, _buffer + _head, _buffer + Capacity);
+        _head = 0;
+        pos = length;
+      }
+      _buffer[pos] = '\0';
+      char *start = _buffer + _head;
+
+      _head = (_head + length + 1) % Capacity;
+      _size -= length + 1;
+      _scanned = 0;
+
+      if (_discarding)
+      {
+        _discarding = false;
+        continue;
+      }
+
+      while (length > 0 && isspace(static_cast<unsigned char>(*start)))
+      {
+        ++start;
+        --length;
+      }
+      while (!hasPayload && length > 0 && isspace(static_cast<unsigned char>(start[length - 1])))
+      {
+        --length;
+      }
+      if (length == 0)
+      {
+        continue;
+      }
+      start[length] = '\0';
+      *line = LineView(start, length);
+      return true;
+    }
+
+    if (_size == Capacity)
+    {
+      // 改行が見つからないままバッファが埋まったので、次の改行まで読み捨てる
+      log_w("BP35A1LineBuffer::nextLine(): line too long, discarded");
+      clear();
+      _discarding = true;
+    }
+    return false;
+  }
+
+  void clear()
+  {
+    _head = 0;
+    _size = 0;
+    _scanned = 0;
+    _discarding = false;
+    _tokenCount = 0;
+    _tokenStart = 0;
+    _payloadRemaining = 0;
+  }
+
+private:
+  static const int NOT_ERXUDP = -1;
+  static const int PAYLOAD_FOUND = -2;
+
+  char at(size_t offset) const { return _buffer[(_head + offset) % Capacity]; }
+
+  // ERXUDP <SENDER> <DEST> <RPORT> <LPORT> <SENDERLLA> <SECURED> [<SIDE>] <DATALEN> <DATA>
+  // の区切りの空白ごとに呼ばれ、DATALEN を見つけたらデータ部の長さを記録する
+  void scanErxudpHeader()
+  {
+    size_t tokenLength = _scanned - _tokenStart;
+    if (_tokenCount == 0)
+    {
+      static const char PREFIX[] = "ERXUDP";
+      bool matched = tokenLength == sizeof(PREFIX) - 1;
+      for (size_t i = 0; matched && i < tokenLength; i++)
+      {
+        matched = at(_tokenStart + i) == PREFIX[i];
+      }
+      if (!matched)
+      {
+        _tokenCount = NOT_ERXUDP;
+        return;
+      }
+    }
+    else if (_tokenCount >= 7 && tokenLength == 4)
+    {
+      size_t length = 0;
+      for (size_t i = 0; i < 4; i++)
+      {
+        char c = at(_tokenStart + i);
+        int value = isdigit(static_cast<unsigned char>(c)) ? c - '0' : toupper(c) - 'A' + 10;
+        length = (length << 4) | (value & 0x0F);
+      }
+      _payloadRemaining = length;
+      _tokenCount = PAYLOAD_FOUND;
+      return;
+    }
+    else if (_tokenCount >= 8)
+    {
+      _tokenCount = NOT_ERXUDP;
+      return;
+    }
+    ++_tokenCount;
+    _tokenStart = _scanned + 1;
+  }
+
+  char _buffer[Capacity];
+  size_t _head = 0;         // 未処理データの先頭位置
+  size_t _size = 0;         // 未処理データのバイト数
+  size_t _scanned = 0;      // 改行を探索済みのバイト数
+  bool _discarding = false; // 長すぎる行を読み捨て中
+
+  bool _binaryPayload = false;  // ERXUDP のデータ部をバイナリとして扱う
+  int _tokenCount = 0;          // 読み取り中の行の ERXUDP ヘッダの要素数
+  size_t _tokenStart = 0;       // 読み取り中の要素の先頭(_head からのオフセット)
+  size_t _payloadRemaining = 0; // 改行判定をせずに読み進めるデータ部の残りバイト数
+};
+
+#endif
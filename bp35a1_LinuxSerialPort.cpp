@@ -0,0 +1,172 @@
+#include "bp35a1_LinuxSerialPort.h"
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace
+{
+  speed_t toSpeed(unsigned long baudRate)
+  {
+    switch (baudRate)
+    {
+    case 9600:
+      return B9600;
+    case 19200:
+      return B19200;
+    case 38400:
+      return B38400;
+    case 57600:
+      return B57600;
+    case 115200:
+      return B115200;
+    case 230400:
+      return B230400;
+    default:
+      return 0;
+    }
+  }
+}
+
+bool LinuxSerialPort::open(const char *path, unsigned long baudRate)
+{
+  close();
+
+  speed_t speed = toSpeed(baudRate);
+  if (speed == 0)
+  {
+    log_e("LinuxSerialPort::open(): Not supported baud rate: %lu", baudRate);
+    return false;
+  }
+
+  _fd = ::open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if (_fd < 0)
+  {
+    log_e("LinuxSerialPort::open(): Cannot open %s: %s", path, strerror(errno));
+    return false;
+  }
+
+  termios tty;
+  if (tcgetattr(_fd, &tty) != 0)
+  {
+    log_e("LinuxSerialPort::open(): tcgetattr failed: %s", strerror(errno));
+    close();
+    return false;
+  }
+  cfmakeraw(&tty);
+  tty.c_cflag |= CLOCAL | CREAD;
+  tty.c_cflag &= ~(CSTOPB | CRTSCTS);
+  tty.c_cc[VMIN] = 0;
+  tty.c_cc[VTIME] = 0;
+  cfsetispeed(&tty, speed);
+  cfsetospeed(&tty, speed);
+  if (tcsetattr(_fd, TCSANOW, &tty) != 0)
+  {
+    log_e("LinuxSerialPort::open(): tcsetattr failed: %s", strerror(errno));
+    close();
+    return false;
+  }
+  tcflush(_fd, TCIOFLUSH);
+  return true;
+}
+
+void LinuxSerialPort::close()
+{
+  if (_fd >= 0)
+  {
+    ::close(_fd);
+    _fd = -1;
+  }
+}
+
+int LinuxSerialPort::available()
+{
+  int size = 0;
+  if (_fd < 0 || ioctl(_fd, FIONREAD, &size) != 0)
+  {
+    return 0;
+  }
+  return size;
+}
+
+int LinuxSerialPort::read()
+{
+  char c;
+  return readBytes(&c, 1) == 1 ? static_cast<byte>(c) : -1;
+}
+
+size_t LinuxSerialPort::readBytes(char *buffer, size_t length)
+{
+  if (_fd < 0)
+  {
+    return 0;
+  }
+  ssize_t size;
+  do
+  {
+    size = ::read(_fd, buffer, length);
+  } while (size < 0 && errno == EINTR);
+  return size > 0 ? size : 0;
+}
+
+size_t LinuxSerialPort::write(const byte *data, size_t size)
+{
+  size_t written = 0;
+  while (_fd >= 0 && written < size)
+  {
+    ssize_t result = ::write(_fd, data + written, size - written);
+    if (result > 0)
+    {
+      written += result;
+    }
+    else if (result < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    else if (result < 0 && errno == EAGAIN)
+    {
+      // 送信バッファが空くまで待つ
+      if (!waitFor(POLLOUT, 1000))
+      {
+        log_e("LinuxSerialPort::write(): Timeout");
+        break;
+      }
+    }
+    else
+    {
+      log_e("LinuxSerialPort::write(): %s", strerror(errno));
+      break;
+    }
+  }
+  return written;
+}
+
+bool LinuxSerialPort::waitForData(unsigned long timeoutMs)
+{
+  return available() > 0 || waitFor(POLLIN, timeoutMs);
+}
+
+bool LinuxSerialPort::waitFor(short events, int timeoutMs)
+{
+  if (_fd < 0)
+  {
+    return false;
+  }
+  // 呼び出し側が getFd() を自分の epoll に登録していても影響しないよう、その場限りの poll() で待つ
+  pollfd target = {};
+  target.fd = _fd;
+  target.events = events;
+  int count;
+  do
+  {
+    count = ::poll(&target, 1, timeoutMs);
+  } while (count < 0 && errno == EINTR);
+  return count > 0 && (target.revents & events) != 0;
+}
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef BP35A1_LINUX_SERIAL_PORT_H_
+#define BP35A1_LINUX_SERIAL_PORT_H_
+
+#include "bp35a1_SerialPort.h"
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+// USB-UART などにつないだ BP35A1 を Linux のシリアルデバイスとして使う SerialPort
+// termios の raw モード(8N1、フロー制御なし)・ノンブロッキングで開き、受信待ちは poll で行う
+class LinuxSerialPort final : public SerialPort
+{
+public:
+  LinuxSerialPort() {}
+  ~LinuxSerialPort() override { close(); }
+  LinuxSerialPort(const LinuxSerialPort &) = delete;
+  LinuxSerialPort &operator=(const LinuxSerialPort &) = delete;
+
+  bool open(const char *path, unsigned long baudRate = 115200);
+  void close();
+  bool isOpen() const { return _fd >= 0; }
+  int getFd() const { return _fd; }
+
+  int available() override;
+  int read() override;
+  size_t readBytes(char *buffer, size_t length) override;
+  size_t write(const byte *data, size_t size) override;
+  using SerialPort::write;
+  bool waitForData(unsigned long timeoutMs) override;
+
+private:
+  bool waitFor(short events, int timeoutMs);
+
+  int _fd = -1;
+};
+
+#endif
+
+#endif
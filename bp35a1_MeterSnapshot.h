@@ -0,0 +1,63 @@
+#ifndef BP35A1_METER_SNAPSHOT_H_
+#define BP35A1_METER_SNAPSHOT_H_
+
+#include "bp35a1_Platform.h"
+
+// 取得したすべての値を 1 つにまとめた POD。BasicBP35A1::getSnapshot() で取り出す
+// 同じ応答フレームで受信した値(係数と積算電力量など)は必ずそろって入る
+// 使用しない EPC の値は BP35A1_DISABLE_EPC_XX で MeterData と一緒に取り除かれる
+struct MeterSnapshot
+{
+  uint32_t sequence;       // 公開するたびに 1 ずつ増える。0 はまだ何も受信していない
+  unsigned long updatedAt; // 最後に値を受信した時刻(ms)
+
+  int coefficient; // 積算電力量の係数
+  float powerUnit; // 積算電力量の単位(kWh)
+#ifndef BP35A1_DISABLE_EPC_E0
+  float totalPower; // 積算電力量計測値(kWh)。係数と単位を適用済み
+#endif
+#ifndef BP35A1_DISABLE_EPC_E2
+  int totalPowerHistoriesDay;   // 積算電力量計測値履歴の日(日前)
+  long totalPowerHistories[48]; // 積算電力量計測値履歴(30 分ごと、係数と単位は未適用)
+#endif
+#ifndef BP35A1_DISABLE_EPC_E5
+  byte collectionDay; // 積算履歴収集日
+#endif
+#ifndef BP35A1_DISABLE_EPC_E7
+  int instantaneousPower; // 瞬時電力計測値(W)
+#endif
+#ifndef BP35A1_DISABLE_EPC_E8
+  int amperageR; // 瞬時電流計測値 R 相(0.1A)
+  int amperageT; // 瞬時電流計測値 T 相(0.1A)。単相 2 線式では 0x7FFE
+#endif
+#ifndef BP35A1_DISABLE_EPC_EA
+  float currentTotalPower; // 最新 30 分毎の積算電力量計測値(kWh)。係数と単位を適用済み
+#endif
+#ifndef BP35A1_DISABLE_EPC_C0
+  byte bRouteId[16];
+#endif
+#ifndef BP35A1_DISABLE_EPC_D0
+  byte oneMinuteTotalPower[15];
+#endif
+#ifndef BP35A1_DISABLE_EPC_D7
+  byte effectiveDigits;
+#endif
+#ifndef BP35A1_DISABLE_EPC_E3
+  long reverseTotalPower;
+#endif
+#ifndef BP35A1_DISABLE_EPC_E4
+  byte reverseTotalPowerHistories[194];
+#endif
+#ifndef BP35A1_DISABLE_EPC_EB
+  byte reverseCurrentTotalPower[11];
+#endif
+#ifndef BP35A1_DISABLE_EPC_EE
+  byte totalPowerHistories3[87];
+  byte totalPowerHistories3Length;
+#endif
+#ifndef BP35A1_DISABLE_EPC_EF
+  byte totalHistoryCollectionDate3[7];
+#endif
+};
+
+#endif
@@ -0,0 +1,36 @@
+#include "bp35a1_Platform.h"
+
+#ifndef ARDUINO
+
+#include <chrono>
+#include <thread>
+
+unsigned long millis()
+{
+  static const auto start = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+void delay(unsigned long ms)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void bp35a1Yield()
+{
+  std::this_thread::yield();
+}
+
+void bp35a1HostLog(int level, const char *format, ...)
+{
+  if (level > BP35A1_HOST_LOG_LEVEL)
+  {
+    return;
+  }
+  va_list args;
+  va_start(args, format);
+  vfprintf(stderr, format, args);
+  va_end(args);
+}
+
+#endif
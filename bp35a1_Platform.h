@@ -0,0 +1,80 @@
+#ifndef BP35A1_PLATFORM_H_
+#define BP35A1_PLATFORM_H_
+
+// Arduino では Arduino.h をそのまま使い、それ以外(Linux などのホスト)では
+// ライブラリが使う Arduino の型・関数・ログマクロだけを用意する
+
+#ifdef ARDUINO
+#include "Arduino.h"
+#else
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+typedef uint8_t byte;
+
+unsigned long millis(); // 起動からの経過時間(ms)。単調増加する時計を使う
+void delay(unsigned long ms);
+
+// Arduino の String のうちライブラリが使う部分だけを std::string で実装する
+class String
+{
+public:
+  String() {}
+  String(const char *str) : _str(str != nullptr ? str : "") {}
+  String(const std::string &str) : _str(str) {}
+
+  const char *c_str() const { return _str.c_str(); }
+  unsigned int length() const { return _str.length(); }
+  String &operator+=(char c)
+  {
+    _str += c;
+    return *this;
+  }
+  String &operator+=(const char *str)
+  {
+    _str += str;
+    return *this;
+  }
+  bool operator==(const String &other) const { return _str == other._str; }
+  bool operator==(const char *str) const { return _str == str; }
+  bool operator!=(const String &other) const { return _str != other._str; }
+  bool operator!=(const char *str) const { return _str != str; }
+
+private:
+  std::string _str;
+};
+
+// ログの出力レベル。0: なし, 1: エラー, 2: 警告, 3: デバッグ
+#ifndef BP35A1_HOST_LOG_LEVEL
+#define BP35A1_HOST_LOG_LEVEL 1
+#endif
+
+void bp35a1HostLog(int level, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+#define log_e(format, ...) bp35a1HostLog(1, "[E] " format "\n", ##__VA_ARGS__)
+#define log_w(format, ...) bp35a1HostLog(2, "[W] " format "\n", ##__VA_ARGS__)
+#define log_d(format, ...) bp35a1HostLog(3, "[D] " format "\n", ##__VA_ARGS__)
+
+#endif
+
+// millis() / delay() を使う時計。BasicBP35A1 の既定の Clock
+struct MillisClock
+{
+  static unsigned long now() { return millis(); }
+  static void sleep(unsigned long ms) { delay(ms); }
+};
+
+// スピン待ちの間に他のタスク(スレッド)へ実行を譲る
+#ifdef ARDUINO
+// FreeRTOS の yield() は同じ優先度以上のタスクにしか譲らないので、優先度の低いタスクも動けるよう 1 tick 休む
+inline void bp35a1Yield() { delay(1); }
+#else
+void bp35a1Yield(); // std::this_thread::yield()
+#endif
+
+#endif
@@ -0,0 +1,167 @@
+#include "bp35a1_PollPlan.h"
+
+#include <algorithm>
+
+bool PollPlan::add(CmdType command, unsigned long interval, unsigned long now)
+{
+  if (interval == 0 || PropertyRegistry::find(static_cast<byte>(command)) == nullptr)
+  {
+    log_e("PollPlan::add(): Not supported EPC: %02X", static_cast<byte>(command));
+    return false;
+  }
+
+  Entry *entry = find(command);
+  if (entry == nullptr)
+  {
+    for (auto &e : _entries)
+    {
+      if (e.interval == 0)
+      {
+        entry = &e;
+        break;
+      }
+    }
+    if (entry == nullptr)
+    {
+      log_w("PollPlan::add(): too many properties");
+      return false;
+    }
+    entry->command = command;
+    entry->due = now;
+    entry->tid = 0;
+  }
+  entry->interval = interval;
+  return true;
+}
+
+bool PollPlan::remove(CmdType command)
+{
+  Entry *entry = find(command);
+  if (entry == nullptr)
+  {
+    return false;
+  }
+  *entry = Entry();
+  return true;
+}
+
+void PollPlan::clear()
+{
+  _entries.fill(Entry());
+}
+
+size_t PollPlan::size() const
+{
+  return std::count_if(_entries.begin(), _entries.end(), [](const Entry &e)
+                       { return e.interval != 0; });
+}
+
+std::vector<CmdType> PollPlan::nextBatch(unsigned long now, size_t maxRequestSize) const
+{
+  // 期限切れのものを先に、同じ区分の中では応答の大きいものから詰める(First Fit Decreasing)
+  std::vector<const Entry *> candidates;
+  bool hasDue = false;
+  for (const auto &entry : _entries)
+  {
+    long remaining = static_cast<long>(entry.due - now);
+    if (entry.interval != 0 && entry.tid == 0 && remaining <= BP35A1_POLL_COALESCE_WINDOW)
+    {
+      candidates.push_back(&entry);
+      hasDue = hasDue || remaining <= 0;
+    }
+  }
+  std::vector<CmdType> batch;
+  if (!hasDue)
+  {
+    return batch;
+  }
+
+  std::sort(candidates.begin(), candidates.end(), [now](const Entry *a, const Entry *b)
+            {
+              bool aDue = static_cast<long>(a->due - now) <= 0;
+              bool bDue = static_cast<long>(b->due - now) <= 0;
+              if (aDue != bDue)
+                return aDue;
+              return responseSize(a->command) > responseSize(b->command); });
+
+  size_t requestSize = EchonetFrame::HEADER_SIZE;
+  size_t responseTotal = EchonetFrame::HEADER_SIZE;
+  for (const auto *entry : candidates)
+  {
+    size_t size = responseSize(entry->command);
+    if (requestSize + 2 > maxRequestSize || responseTotal + size > BP35A1_MAX_RESPONSE_SIZE)
+    {
+      continue;
+    }
+    requestSize += 2;
+    responseTotal += size;
+    batch.push_back(entry->command);
+  }
+  return batch;
+}
+
+void PollPlan::assign(const std::vector<CmdType> &commands, uint16_t tid)
+{
+  for (const auto &command : commands)
+  {
+    Entry *entry = find(command);
+    if (entry != nullptr)
+    {
+      entry->tid = tid;
+    }
+  }
+}
+
+void PollPlan::finish(uint16_t tid, CommandStatus status, unsigned long now, const PropertyCallback &callback)
+{
+  for (auto &entry : _entries)
+  {
+    if (entry.interval != 0 && entry.tid == tid)
+    {
+      finishEntry(&entry, status, now, callback);
+    }
+  }
+}
+
+void PollPlan::finish(uint16_t tid, CmdType command, CommandStatus status, unsigned long now, const PropertyCallback &callback)
+{
+  Entry *entry = find(command);
+  if (entry != nullptr && entry->tid == tid)
+  {
+    finishEntry(entry, status, now, callback);
+  }
+}
+
+void PollPlan::finishEntry(Entry *entry, CommandStatus status, unsigned long now, const PropertyCallback &callback)
+{
+  entry->tid = 0;
+  // 周期を保ったまま次の期限を決める。大きく遅れた場合は今から 1 周期後
+  entry->due += entry->interval;
+  if (static_cast<long>(entry->due - now) <= 0)
+  {
+    entry->due = now + entry->interval;
+  }
+  if (callback)
+  {
+    callback(entry->command, status);
+  }
+}
+
+size_t PollPlan::responseSize(CmdType command)
+{
+  // EPC, PDC, EDT。PDC が可変のプロパティは最大長で見積もる
+  const PropertyDecoder *decoder = PropertyRegistry::find(static_cast<byte>(command));
+  return 2 + (decoder != nullptr && decoder->pdc != 0 ? decoder->pdc : 0xFF);
+}
+
+PollPlan::Entry *PollPlan::find(CmdType command)
+{
+  for (auto &entry : _entries)
+  {
+    if (entry.interval != 0 && entry.command == command)
+    {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
@@ -0,0 +1,66 @@
+#ifndef BP35A1_POLL_PLAN_H_
+#define BP35A1_POLL_PLAN_H_
+
+#include "bp35a1_Platform.h"
+
+#include "bp35a1_EchonetFrame.h"
+#include "bp35a1_PropertyRegistry.h"
+
+#include <array>
+#include <functional>
+#include <vector>
+
+// 定期取得に登録できるプロパティの数
+#ifndef BP35A1_MAX_POLL_PROPERTIES
+#define BP35A1_MAX_POLL_PROPERTIES 16
+#endif
+
+// 1 つの Get 要求にまとめる応答フレームの最大長(バイト)
+// ASCII モードでは ERXUDP 行が受信バッファに収まるように、ヘッダ分を除いた半分を上限にする
+#ifndef BP35A1_MAX_RESPONSE_SIZE
+#define BP35A1_MAX_RESPONSE_SIZE ((BP35A1_RX_BUFFER_SIZE - 128) / 2 < BP35A1_FRAME_BUFFER_SIZE ? (BP35A1_RX_BUFFER_SIZE - 128) / 2 : BP35A1_FRAME_BUFFER_SIZE)
+#endif
+
+// 期限が来たらまとめて取得する範囲(ms)。この時間内に期限が来るプロパティも同じ要求に載せる
+#ifndef BP35A1_POLL_COALESCE_WINDOW
+#define BP35A1_POLL_COALESCE_WINDOW 1000
+#endif
+
+enum class CommandStatus : byte;
+
+// 取得周期ごとに登録したプロパティのうち期限が来たものを、
+// 要求・応答のサイズ上限に収まる最小限の OPC 付き Get 要求にまとめる
+class PollPlan
+{
+public:
+  typedef std::function<void(CmdType command, CommandStatus status)> PropertyCallback;
+
+  bool add(CmdType command, unsigned long interval, unsigned long now); // 登録済みなら周期を更新する
+  bool remove(CmdType command);
+  void clear();
+  size_t size() const;
+
+  // now の時点で取得すべきプロパティを 1 要求分取り出す。なければ空
+  std::vector<CmdType> nextBatch(unsigned long now, size_t maxRequestSize) const;
+  void assign(const std::vector<CmdType> &commands, uint16_t tid); // nextBatch() の結果を TID の要求として送信済みにする
+  void finish(uint16_t tid, CommandStatus status, unsigned long now, const PropertyCallback &callback);                   // TID の要求に含まれる残りすべて
+  void finish(uint16_t tid, CmdType command, CommandStatus status, unsigned long now, const PropertyCallback &callback); // TID の要求に含まれる 1 つ
+
+  static size_t responseSize(CmdType command); // Get_Res に含まれるプロパティ 1 つ分のバイト数
+
+private:
+  struct Entry
+  {
+    CmdType command = CmdType::COEFFICIENT;
+    unsigned long interval = 0; // 取得周期(ms)。0 は未使用
+    unsigned long due = 0;      // 次に取得する時刻(ms)
+    uint16_t tid = 0;           // 応答待ちの要求の TID。0 は未送信
+  };
+
+  Entry *find(CmdType command);
+  static void finishEntry(Entry *entry, CommandStatus status, unsigned long now, const PropertyCallback &callback);
+
+  std::array<Entry, BP35A1_MAX_POLL_PROPERTIES> _entries;
+};
+
+#endif
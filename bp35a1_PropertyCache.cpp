@@ -0,0 +1,125 @@
+#include "bp35a1_PropertyCache.h"
+
+PropertyCache::PropertyCache()
+{
+  // 計測値の換算やメーターの識別に使う値は変わらないので、一度取得したら使い続ける
+  setTtl(CmdType::B_ROUTE_ID, NO_EXPIRY);
+  setTtl(CmdType::COEFFICIENT, NO_EXPIRY);
+  setTtl(CmdType::EFFECTIVE_DIGITS, NO_EXPIRY);
+  setTtl(CmdType::POWER_UNIT, NO_EXPIRY);
+}
+
+void PropertyCache::setTtl(CmdType command, unsigned long ttl)
+{
+  Entry *entry = find(static_cast<byte>(command));
+  if (entry != nullptr)
+  {
+    entry->ttl = ttl;
+  }
+}
+
+unsigned long PropertyCache::getTtl(CmdType command) const
+{
+  const Entry *entry = find(static_cast<byte>(command));
+  return entry == nullptr ? 0 : entry->ttl;
+}
+
+void PropertyCache::update(byte epc, uint16_t tid, unsigned long now)
+{
+  Entry *entry = find(epc);
+  if (entry != nullptr)
+  {
+    entry->receivedAt = now;
+    entry->tid = tid;
+    entry->received = true;
+  }
+}
+
+void PropertyCache::invalidate(CmdType command)
+{
+  Entry *entry = find(static_cast<byte>(command));
+  if (entry != nullptr)
+  {
+    entry->received = false;
+  }
+}
+
+void PropertyCache::clear()
+{
+  for (auto &entry : _entries)
+  {
+    entry.received = false;
+  }
+}
+
+bool PropertyCache::isFresh(CmdType command, unsigned long now) const
+{
+  const Entry *entry = find(static_cast<byte>(command));
+  if (entry == nullptr || !entry->received || entry->ttl == 0)
+  {
+    return false;
+  }
+  return entry->ttl == NO_EXPIRY || now - entry->receivedAt < entry->ttl;
+}
+
+unsigned long PropertyCache::getAge(CmdType command, unsigned long now) const
+{
+  const Entry *entry = find(static_cast<byte>(command));
+  return entry == nullptr || !entry->received ? NO_DATA : now - entry->receivedAt;
+}
+
+unsigned long PropertyCache::getReceivedAt(CmdType command) const
+{
+  const Entry *entry = find(static_cast<byte>(command));
+  return entry == nullptr || !entry->received ? 0 : entry->receivedAt;
+}
+
+uint16_t PropertyCache::getTid(CmdType command) const
+{
+  const Entry *entry = find(static_cast<byte>(command));
+  return entry == nullptr || !entry->received ? 0 : entry->tid;
+}
+
+void PropertyCache::assign(CmdType command, uint16_t tid)
+{
+  Entry *entry = find(static_cast<byte>(command));
+  if (entry != nullptr)
+  {
+    entry->pendingTid = tid;
+  }
+}
+
+uint16_t PropertyCache::getPending(CmdType command) const
+{
+  const Entry *entry = find(static_cast<byte>(command));
+  return entry == nullptr ? 0 : entry->pendingTid;
+}
+
+void PropertyCache::finish(uint16_t tid)
+{
+  for (auto &entry : _entries)
+  {
+    if (entry.pendingTid == tid)
+    {
+      entry.pendingTid = 0;
+    }
+  }
+}
+
+PropertyCache::Entry *PropertyCache::find(byte epc)
+{
+  if (epc < PropertyRegistry::FIRST_EPC || epc > PropertyRegistry::LAST_EPC)
+  {
+    return nullptr;
+  }
+  return &_entries[epc - PropertyRegistry::FIRST_EPC];
+}
+
+const PropertyCache::Entry *PropertyCache::find(byte epc) const
+{
+  if (epc < PropertyRegistry::FIRST_EPC || epc > PropertyRegistry::LAST_EPC)
+  {
+    return nullptr;
+  }
+  return &_entries[epc - PropertyRegistry::FIRST_EPC];
+}
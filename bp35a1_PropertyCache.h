@@ -0,0 +1,57 @@
+#ifndef BP35A1_PROPERTY_CACHE_H_
+#define BP35A1_PROPERTY_CACHE_H_
+
+#include "bp35a1_Platform.h"
+
+#include "bp35a1_PropertyRegistry.h"
+
+#include <array>
+
+// 取得した値をそのまま使う時間(ms)の既定値。プロパティごとに PropertyCache::setTtl() で変えられる
+#ifndef BP35A1_DEFAULT_PROPERTY_TTL
+#define BP35A1_DEFAULT_PROPERTY_TTL 1000
+#endif
+
+// MeterData に保存した値を受信した時刻と有効期間(TTL)、取得中の要求を EPC ごとに記録する
+// 有効期間内の値は送信せずに使い、取得中のプロパティは同じ要求の完了を待つ
+class PropertyCache
+{
+public:
+  static const unsigned long NO_EXPIRY = 0xFFFFFFFFUL; // 期限切れにならない(係数・単位など変わらない値)
+  static const unsigned long NO_DATA = 0xFFFFFFFFUL;   // getAge() でまだ受信していない
+
+  PropertyCache();
+
+  void setTtl(CmdType command, unsigned long ttl); // 0 なら常に取得し直す
+  unsigned long getTtl(CmdType command) const;
+
+  void update(byte epc, uint16_t tid, unsigned long now); // 値を受信した。tid は通知なら 0
+  void invalidate(CmdType command);                      // 次は必ず取得し直す
+  void clear();                                          // すべての値を未受信にする
+
+  bool isFresh(CmdType command, unsigned long now) const;
+  unsigned long getAge(CmdType command, unsigned long now) const; // 受信してからの時間(ms)。未受信なら NO_DATA
+  unsigned long getReceivedAt(CmdType command) const;             // 受信した時刻(ms)。未受信なら 0
+  uint16_t getTid(CmdType command) const;                         // 値を受信した要求の TID
+
+  void assign(CmdType command, uint16_t tid); // tid の Get 要求で取得中にする
+  uint16_t getPending(CmdType command) const; // 取得中の要求の TID。なければ 0
+  void finish(uint16_t tid);                  // tid の要求が完了した
+
+private:
+  struct Entry
+  {
+    unsigned long receivedAt = 0;                    // 受信した時刻(ms)
+    unsigned long ttl = BP35A1_DEFAULT_PROPERTY_TTL; // 有効期間(ms)
+    uint16_t tid = 0;                                // 値を受信した要求の TID
+    uint16_t pendingTid = 0;                         // 取得中の要求の TID
+    bool received = false;
+  };
+
+  Entry *find(byte epc);
+  const Entry *find(byte epc) const;
+
+  std::array<Entry, PropertyRegistry::LAST_EPC - PropertyRegistry::FIRST_EPC + 1> _entries;
+};
+
+#endif
@@ -0,0 +1,84 @@
+#include "bp35a1_PropertyMap.h"
+
+bool PropertyMap::parse(const byte *edt, size_t pdc)
+{
+  if (pdc == 0)
+  {
+    return false;
+  }
+  size_t count = edt[0];
+  if (count < 16)
+  {
+    if (pdc < 1 + count)
+    {
+      return false;
+    }
+    clear();
+    for (size_t i = 0; i < count; i++)
+    {
+      set(edt[1 + i]);
+    }
+    return true;
+  }
+  if (pdc < 1 + SIZE)
+  {
+    return false;
+  }
+  assign(edt + 1);
+  return true;
+}
+
+bool PropertyMapCache::decode(const EchonetProperty &property)
+{
+  switch (property.epc)
+  {
+  case 0x9D:
+    return announce.parse(property.edt, property.pdc);
+  case 0x9E:
+    setLoaded = set.parse(property.edt, property.pdc);
+    return setLoaded;
+  case 0x9F:
+    getLoaded = get.parse(property.edt, property.pdc);
+    return getLoaded;
+  default:
+    return false;
+  }
+}
+
+size_t PropertyMapCache::exportTo(byte *out, size_t size) const
+{
+  if ((!setLoaded && !getLoaded) || out == nullptr || size < EXPORT_SIZE)
+  {
+    return 0;
+  }
+  out[0] = FORMAT_VERSION;
+  out[1] = (setLoaded ? 0x01 : 0x00) | (getLoaded ? 0x02 : 0x00);
+  memcpy(out + 2, announce.data(), PropertyMap::SIZE);
+  memcpy(out + 2 + PropertyMap::SIZE, set.data(), PropertyMap::SIZE);
+  memcpy(out + 2 + PropertyMap::SIZE * 2, get.data(), PropertyMap::SIZE);
+  return EXPORT_SIZE;
+}
+
+bool PropertyMapCache::importFrom(const byte *data, size_t size)
+{
+  if (data == nullptr || size < EXPORT_SIZE || data[0] != FORMAT_VERSION)
+  {
+    log_w("PropertyMapCache::importFrom(): Invalid data");
+    return false;
+  }
+  announce.assign(data + 2);
+  set.assign(data + 2 + PropertyMap::SIZE);
+  get.assign(data + 2 + PropertyMap::SIZE * 2);
+  setLoaded = (data[1] & 0x01) != 0;
+  getLoaded = (data[1] & 0x02) != 0;
+  return true;
+}
+
+void PropertyMapCache::clear()
+{
+  announce.clear();
+  set.clear();
+  get.clear();
+  setLoaded = false;
+  getLoaded = false;
+}
@@ -0,0 +1,70 @@
+#ifndef BP35A1_PROPERTY_MAP_H_
+#define BP35A1_PROPERTY_MAP_H_
+
+#include "bp35a1_Platform.h"
+
+#include "bp35a1_EchonetFrame.h"
+
+#include <array>
+
+// EPC 0x80 ~ 0xFF の集合
+// ECHONET Lite のプロパティマップ(記述形式 2)と同じく、EPC の下位 4 ビットでバイト、上位 4 ビットでビットを選ぶ
+class PropertyMap
+{
+public:
+  static const size_t SIZE = 16;
+
+  bool contains(byte epc) const { return epc >= 0x80 && (_bits[epc & 0x0F] >> ((epc >> 4) - 8)) & 1; }
+  void set(byte epc)
+  {
+    if (epc >= 0x80)
+      _bits[epc & 0x0F] |= 1 << ((epc >> 4) - 8);
+  }
+  void reset(byte epc)
+  {
+    if (epc >= 0x80)
+      _bits[epc & 0x0F] &= ~(1 << ((epc >> 4) - 8));
+  }
+  void clear() { _bits.fill(0); }
+  bool empty() const
+  {
+    for (const auto &b : _bits)
+    {
+      if (b != 0)
+        return false;
+    }
+    return true;
+  }
+
+  // プロパティマップの EDT を読み込む
+  // 記述形式 1: プロパティ数 + EPC の列挙(16 個未満)、記述形式 2: プロパティ数 + 16 バイトのビットマップ
+  bool parse(const byte *edt, size_t pdc);
+
+  const byte *data() const { return _bits.data(); }
+  void assign(const byte *bits) { memcpy(_bits.data(), bits, SIZE); }
+
+private:
+  std::array<byte, SIZE> _bits = {};
+};
+
+// スマートメーターが実装しているプロパティの一覧(EPC 0x9D / 0x9E / 0x9F)
+// exportTo() した内容を保存しておけば、再起動後に importFrom() して問い合わせを省ける
+struct PropertyMapCache
+{
+  static const byte FORMAT_VERSION = 2;
+  static const size_t EXPORT_SIZE = 2 + PropertyMap::SIZE * 3; // バージョン + 取得済みフラグ + 3 つのマップ
+
+  PropertyMap announce; // 状変アナウンスプロパティマップ(0x9D)
+  PropertyMap set;      // Set プロパティマップ(0x9E)
+  PropertyMap get;      // Get プロパティマップ(0x9F)
+  bool setLoaded = false; // Set プロパティマップを取得済み
+  bool getLoaded = false; // Get プロパティマップを取得済み
+
+  static bool isPropertyMap(byte epc) { return epc >= 0x9D && epc <= 0x9F; }
+  bool decode(const EchonetProperty &property);
+  size_t exportTo(byte *out, size_t size) const; // 書き込んだバイト数を返す。size が足りなければ 0
+  bool importFrom(const byte *data, size_t size);
+  void clear();
+};
+
+#endif
@@ -0,0 +1,158 @@
+#include "bp35a1_PropertyRegistry.h"
+
+namespace
+{
+  // EDT から T を構築して保存する
+  template <typename T, T MeterData::*Slot>
+  bool decodeResponse(MeterData *data, const EchonetProperty &property)
+  {
+    data->*Slot = T(property.edt);
+    return true;
+  }
+
+  // EDT をそのまま保存する
+  template <size_t N, std::array<byte, N> MeterData::*Slot>
+  bool decodeRaw(MeterData *data, const EchonetProperty &property)
+  {
+    memcpy((data->*Slot).data(), property.edt, N);
+    return true;
+  }
+
+#ifndef BP35A1_DISABLE_EPC_E2
+  bool decodeTotalPowerHistories(MeterData *data, const EchonetProperty &property)
+  {
+    memcpy(data->totalPowerHistoriesRaw.data(), property.edt, data->totalPowerHistoriesRaw.size());
+    data->totalPowerHistories = TotalPowerHistories(property.edt);
+    return true;
+  }
+#endif
+
+#ifndef BP35A1_DISABLE_EPC_D7
+  bool decodeEffectiveDigits(MeterData *data, const EchonetProperty &property)
+  {
+    data->effectiveDigits = property.edt[0];
+    return true;
+  }
+#endif
+
+#ifndef BP35A1_DISABLE_EPC_E3
+  bool decodeReverseTotalPower(MeterData *data, const EchonetProperty &property)
+  {
+    const byte *buf = property.edt;
+    data->reverseTotalPower = (static_cast<long>(buf[0]) << 24) |
+                              (static_cast<long>(buf[1]) << 16) |
+                              (static_cast<long>(buf[2]) << 8) |
+                              static_cast<long>(buf[3]);
+    return true;
+  }
+#endif
+
+#ifndef BP35A1_DISABLE_EPC_EE
+  bool decodeTotalPowerHistories3(MeterData *data, const EchonetProperty &property)
+  {
+    data->totalPowerHistories3Length = std::min<size_t>(property.pdc, data->totalPowerHistories3.size());
+    memcpy(data->totalPowerHistories3.data(), property.edt, data->totalPowerHistories3Length);
+    return true;
+  }
+#endif
+
+  // EPC, PDC, デコーダ
+  constexpr PropertyDecoder DECODERS[] = {
+#ifndef BP35A1_DISABLE_EPC_C0
+      {0xC0, 16, &decodeRaw<16, &MeterData::bRouteId>},                                    // Bルート識別番号
+#endif
+#ifndef BP35A1_DISABLE_EPC_D0
+      {0xD0, 15, &decodeRaw<15, &MeterData::oneMinuteTotalPower>},                         // 1分積算電力量計測値
+#endif
+      {0xD3, 4, &decodeResponse<Coefficient, &MeterData::coefficient>},                    // 係数
+#ifndef BP35A1_DISABLE_EPC_D7
+      {0xD7, 1, &decodeEffectiveDigits},                                                   // 積算電力量有効桁数
+#endif
+#ifndef BP35A1_DISABLE_EPC_E0
+      {0xE0, 4, &decodeResponse<TotalPower, &MeterData::totalPower>},                      // 積算電力量計測値
+#endif
+      {0xE1, 1, &decodeResponse<PowerUnit, &MeterData::powerUnit>},                        // 積算電力量単位
+#ifndef BP35A1_DISABLE_EPC_E2
+      {0xE2, 194, &decodeTotalPowerHistories},                                             // 積算電力量計測値履歴
+#endif
+#ifndef BP35A1_DISABLE_EPC_E3
+      {0xE3, 4, &decodeReverseTotalPower},                                                 // 積算電力量計測値(逆方向)
+#endif
+#ifndef BP35A1_DISABLE_EPC_E4
+      {0xE4, 194, &decodeRaw<194, &MeterData::reverseTotalPowerHistories>},                // 積算電力量計測値履歴(逆方向)
+#endif
+#ifndef BP35A1_DISABLE_EPC_E5
+      {0xE5, 1, &decodeResponse<CollectionDay, &MeterData::collectionDay>},                // 積算履歴収集日
+#endif
+#ifndef BP35A1_DISABLE_EPC_E7
+      {0xE7, 4, &decodeResponse<InstantaneousPower, &MeterData::instantaneousPower>},      // 瞬時電力計測値
+#endif
+#ifndef BP35A1_DISABLE_EPC_E8
+      {0xE8, 4, &decodeResponse<InstantaneousAmperage, &MeterData::instantaneousAmperage>}, // 瞬時電流計測値
+#endif
+#ifndef BP35A1_DISABLE_EPC_EA
+      {0xEA, 11, &decodeResponse<CurrentTotalPower, &MeterData::currentTotalPower>},       // 定時積算電力量
+#endif
+#ifndef BP35A1_DISABLE_EPC_EB
+      {0xEB, 11, &decodeRaw<11, &MeterData::reverseCurrentTotalPower>},                    // 定時積算電力量(逆方向)
+#endif
+#ifndef BP35A1_DISABLE_EPC_EE
+      {0xEE, 0, &decodeTotalPowerHistories3},                                              // 積算電力量計測値履歴3
+#endif
+#ifndef BP35A1_DISABLE_EPC_EF
+      {0xEF, 7, &decodeRaw<7, &MeterData::totalHistoryCollectionDate3>},                   // 積算履歴収集日3
+#endif
+  };
+
+  constexpr size_t DECODER_COUNT = sizeof(DECODERS) / sizeof(DECODERS[0]);
+
+  constexpr int indexOf(int epc, size_t i = 0)
+  {
+    return i == DECODER_COUNT ? -1 : DECODERS[i].epc == epc ? static_cast<int>(i) : indexOf(epc, i + 1);
+  }
+
+  constexpr bool isInRange(size_t i = 0)
+  {
+    return i == DECODER_COUNT || (DECODERS[i].epc >= PropertyRegistry::FIRST_EPC &&
+                                  DECODERS[i].epc <= PropertyRegistry::LAST_EPC && isInRange(i + 1));
+  }
+  static_assert(isInRange(), "EPC must be between FIRST_EPC and LAST_EPC");
+
+#define BP35A1_INDEX_ROW(base)                                                                         \
+  indexOf(base + 0x0), indexOf(base + 0x1), indexOf(base + 0x2), indexOf(base + 0x3),                  \
+      indexOf(base + 0x4), indexOf(base + 0x5), indexOf(base + 0x6), indexOf(base + 0x7),              \
+      indexOf(base + 0x8), indexOf(base + 0x9), indexOf(base + 0xA), indexOf(base + 0xB),              \
+      indexOf(base + 0xC), indexOf(base + 0xD), indexOf(base + 0xE), indexOf(base + 0xF)
+
+  // EPC - FIRST_EPC から DECODERS の添字を引く表。コンパイル時に生成する
+  constexpr int8_t DECODER_INDEX[PropertyRegistry::LAST_EPC - PropertyRegistry::FIRST_EPC + 1] = {
+      BP35A1_INDEX_ROW(0xC0), BP35A1_INDEX_ROW(0xD0), BP35A1_INDEX_ROW(0xE0)};
+
+#undef BP35A1_INDEX_ROW
+}
+
+const PropertyDecoder *PropertyRegistry::find(byte epc)
+{
+  if (epc < FIRST_EPC || epc > LAST_EPC)
+  {
+    return nullptr;
+  }
+  int8_t index = DECODER_INDEX[epc - FIRST_EPC];
+  return index < 0 ? nullptr : &DECODERS[index];
+}
+
+bool PropertyRegistry::decode(MeterData *data, const EchonetProperty &property)
+{
+  const PropertyDecoder *decoder = find(property.epc);
+  if (decoder == nullptr)
+  {
+    log_d("PropertyRegistry::decode(): Not supported EPC: %02X", property.epc);
+    return false;
+  }
+  if (property.pdc < decoder->pdc)
+  {
+    log_e("PropertyRegistry::decode(): Invalid data length");
+    return false;
+  }
+  return decoder->decode(data, property);
+}
@@ -0,0 +1,107 @@
+#ifndef BP35A1_PROPERTY_REGISTRY_H_
+#define BP35A1_PROPERTY_REGISTRY_H_
+
+#include "bp35a1_Platform.h"
+
+#include "bp35a1_EchonetFrame.h"
+#include "bp35a1_UDP_Response.h"
+
+#include <array>
+
+// 使用しない EPC は BP35A1_DISABLE_EPC_XX を定義するとデコーダと保存領域ごと取り除ける
+// 積算電力量の換算に使う係数(D3)と単位(E1)は常に有効
+
+enum class CmdType : byte
+{
+  STATUS_CHANGE_PROPERTY_MAP = 0x9D,    // 状変アナウンスプロパティマップ
+  SET_PROPERTY_MAP = 0x9E,              // Set プロパティマップ
+  GET_PROPERTY_MAP = 0x9F,              // Get プロパティマップ
+  B_ROUTE_ID = 0xC0,                    // Bルート識別番号
+  ONE_MINUTE_TOTAL_POWER = 0xD0,        // 1分積算電力量計測値(正逆)
+  COEFFICIENT = 0xD3,                   // 積算電力量係数を取得する
+  EFFECTIVE_DIGITS = 0xD7,              // 積算電力量有効桁数
+  TOTAL_POWER = 0xE0,                   // 積算電力量計測値(kWh)を取得する
+  POWER_UNIT = 0xE1,                    // 積算電力量単位を取得する
+  TOTAL_POWER_HISTORIES = 0xE2,         // 積算電力量計測値履歴(kWh)を取得する
+  TOTAL_POWER_REVERSE = 0xE3,           // 積算電力量計測値(逆方向)を取得する
+  TOTAL_POWER_HISTORIES_REVERSE = 0xE4, // 積算電力量計測値履歴(逆方向)を取得する
+  TOTAL_HISTORY_COLLECTION_DATE = 0xE5, // 積算履歴収集日を取得/変更する
+  INSTANTANEOUS_POWER = 0xE7,           // 瞬時電力計測値(W)を取得する
+  INSTANTANEOUS_AMPERAGE = 0xE8,        // 瞬時電流計測値(0.1A)を取得する
+  CURRENT_TOTAL_POWER = 0xEA,           // 30分毎の積算電力量計測値(kWh)を取得する
+  CURRENT_TOTAL_POWER_REVERSE = 0xEB,   // 30分毎の積算電力量計測値(逆方向)を取得する
+  TOTAL_POWER_HISTORIES3 = 0xEE,        // 積算電力量計測値履歴3(正逆,1分)
+  TOTAL_HISTORY_COLLECTION_DATE3 = 0xEF // 積算履歴収集日3を取得/変更する
+};
+
+// スマートメーターから取得した値の保存先
+struct MeterData
+{
+  Coefficient coefficient;                     // 積算電力量の係数
+  PowerUnit powerUnit;                         // 積算電力量の単位
+#ifndef BP35A1_DISABLE_EPC_E0
+  TotalPower totalPower;                       // 積算電力量計測値(kWh)
+#endif
+#ifndef BP35A1_DISABLE_EPC_E2
+  TotalPowerHistories totalPowerHistories;     // 積算電力量計測値履歴
+  std::array<byte, 194> totalPowerHistoriesRaw = {};
+#endif
+#ifndef BP35A1_DISABLE_EPC_E5
+  CollectionDay collectionDay;                 // 積算電力量を取得する日(日前)
+#endif
+#ifndef BP35A1_DISABLE_EPC_E7
+  InstantaneousPower instantaneousPower;       // 瞬時電力計測値
+#endif
+#ifndef BP35A1_DISABLE_EPC_E8
+  InstantaneousAmperage instantaneousAmperage; // 瞬時電流計測値
+#endif
+#ifndef BP35A1_DISABLE_EPC_EA
+  CurrentTotalPower currentTotalPower;         // 最新30分毎の積算電力量計測値(kWh)
+#endif
+#ifndef BP35A1_DISABLE_EPC_C0
+  std::array<byte, 16> bRouteId = {};
+#endif
+#ifndef BP35A1_DISABLE_EPC_D0
+  std::array<byte, 15> oneMinuteTotalPower = {};
+#endif
+#ifndef BP35A1_DISABLE_EPC_D7
+  byte effectiveDigits = 0;
+#endif
+#ifndef BP35A1_DISABLE_EPC_E3
+  long reverseTotalPower = BP35A1UdpResponse::NO_DATA;
+#endif
+#ifndef BP35A1_DISABLE_EPC_E4
+  std::array<byte, 194> reverseTotalPowerHistories = {};
+#endif
+#ifndef BP35A1_DISABLE_EPC_EB
+  std::array<byte, 11> reverseCurrentTotalPower = {};
+#endif
+#ifndef BP35A1_DISABLE_EPC_EE
+  std::array<byte, 87> totalPowerHistories3 = {};
+  byte totalPowerHistories3Length = 0;
+#endif
+#ifndef BP35A1_DISABLE_EPC_EF
+  std::array<byte, 7> totalHistoryCollectionDate3 = {};
+#endif
+};
+
+// EPC ごとのデコーダ。PDC が pdc 未満の EDT はデコーダに渡さない
+struct PropertyDecoder
+{
+  byte epc;
+  byte pdc;
+  bool (*decode)(MeterData *data, const EchonetProperty &property);
+};
+
+// EPC からデコーダを引く。登録は bp35a1_PropertyRegistry.cpp の DECODERS に 1 行追加する
+class PropertyRegistry
+{
+public:
+  static const byte FIRST_EPC = 0xC0;
+  static const byte LAST_EPC = 0xEF;
+
+  static const PropertyDecoder *find(byte epc);
+  static bool decode(MeterData *data, const EchonetProperty &property);
+};
+
+#endif
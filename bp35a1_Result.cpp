@@ -0,0 +1,35 @@
+#include "bp35a1_Result.h"
+
+const char *toString(ErrorCategory error)
+{
+  switch (error)
+  {
+  case ErrorCategory::NONE:
+    return "none";
+  case ErrorCategory::BUSY:
+    return "busy";
+  case ErrorCategory::INVALID_ARGUMENT:
+    return "invalid argument";
+  case ErrorCategory::NOT_CONNECTED:
+    return "not connected";
+  case ErrorCategory::COMMAND_ERROR:
+    return "command error";
+  case ErrorCategory::TIMEOUT:
+    return "timeout";
+  case ErrorCategory::NOT_FOUND:
+    return "not found";
+  case ErrorCategory::CONNECTION_FAILED:
+    return "connection failed";
+  case ErrorCategory::SEND_FAILED:
+    return "send failed";
+  case ErrorCategory::NO_RESPONSE:
+    return "no response";
+  case ErrorCategory::DEADLINE_EXCEEDED:
+    return "deadline exceeded";
+  case ErrorCategory::REJECTED:
+    return "rejected";
+  case ErrorCategory::INVALID_RESPONSE:
+    return "invalid response";
+  }
+  return "unknown";
+}
@@ -0,0 +1,40 @@
+#ifndef BP35A1_RESULT_H_
+#define BP35A1_RESULT_H_
+
+#include "bp35a1_Platform.h"
+
+// コマンド・要求が失敗した原因
+enum class ErrorCategory : byte
+{
+  NONE,              // 成功
+  BUSY,              // 他のコマンドを実行中、または要求の空きがない
+  INVALID_ARGUMENT,  // 引数が不正、またはスキャン結果などの前提がそろっていない
+  NOT_CONNECTED,     // PANA 接続していない
+  COMMAND_ERROR,     // FAIL ER<code>
+  TIMEOUT,           // コマンドの応答がない
+  NOT_FOUND,         // スキャンで PAN が見つからない
+  CONNECTION_FAILED, // EVENT 24(PANA 接続・再認証の失敗)
+  SEND_FAILED,       // EVENT 21 のステータスが 00 以外で、再送しても送信できなかった
+  NO_RESPONSE,       // 送信できたが、再送してもメーターの応答がない
+  DEADLINE_EXCEEDED, // RetryPolicy::deadline を過ぎた
+  REJECTED,          // Get_SNA / SetC_SNA、またはメーターが対応していないプロパティ
+  INVALID_RESPONSE   // メーターの応答が不正
+};
+
+const char *toString(ErrorCategory error);
+
+// コマンド・要求の結果。失敗した場合は原因と BP35A1 の応答を持つ
+// bool に変換すると成功したかどうかになる
+struct CommandResult
+{
+  ErrorCategory error;
+  byte errorCode;        // FAIL ER の番号(ER04 なら 4)。COMMAND_ERROR のときだけ
+  byte event21Status;    // 最後に受信した EVENT 21 のステータス(00: 成功 01: 失敗 02: 準備中)
+  unsigned long elapsed; // 開始してから完了するまでの時間(ms)
+  byte retries;          // 再送・再スキャンした回数
+
+  bool ok() const { return error == ErrorCategory::NONE; }
+  explicit operator bool() const { return ok(); }
+};
+
+#endif
@@ -0,0 +1,35 @@
+#include "bp35a1_RetryPolicy.h"
+
+unsigned long RetryPolicy::getDelay(RetryReason reason, byte attempt, uint32_t random) const
+{
+  if (reason == RetryReason::PREPARING)
+  {
+    return preparingDelay;
+  }
+
+  unsigned long delay = baseDelay;
+  for (byte i = 1; i < attempt && delay < maxDelay; i++)
+  {
+    delay *= 2;
+  }
+  if (delay > maxDelay)
+  {
+    delay = maxDelay;
+  }
+  unsigned long range = delay * jitterPercent / 100;
+  if (range > 0)
+  {
+    delay = delay - range + random % (2 * range + 1);
+  }
+  return delay;
+}
+
+uint32_t RetryPolicy::nextRandom(uint32_t *state)
+{
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
@@ -0,0 +1,33 @@
+#ifndef BP35A1_RETRY_POLICY_H_
+#define BP35A1_RETRY_POLICY_H_
+
+#include "bp35a1_Platform.h"
+
+// ECHONET Lite 要求を再送する理由
+enum class RetryReason : byte
+{
+  SEND_FAILED, // EVENT 21 ステータス 01 や SKSENDTO のタイムアウト。送信できなかった
+  PREPARING,   // EVENT 21 ステータス 02。送信準備中(アドレス解決など)ですぐに送り直せる
+  NO_RESPONSE  // 送信できたが ERXUDP が届かない
+};
+
+// ECHONET Lite 要求(Get / SetC / INFC_Res)の再送方法
+// 待ち時間は baseDelay から失敗するごとに倍になり、maxDelay で頭打ちになる
+struct RetryPolicy
+{
+  byte maxAttempts = 3;                 // SEND_FAILED / NO_RESPONSE を合わせた送信回数の上限
+  byte maxPreparing = 3;                // PREPARING で送り直す回数の上限
+  unsigned long responseTimeout = 5000; // 送信してから ERXUDP を待つ時間(ms)
+  unsigned long baseDelay = 1000;       // 1 回目の再送までの待ち時間(ms)
+  unsigned long maxDelay = 4000;        // 再送までの待ち時間の上限(ms)
+  byte jitterPercent = 25;              // 待ち時間を ± この割合だけゆらがせ、複数のメーターの再送が重ならないようにする
+  unsigned long preparingDelay = 100;   // PREPARING の後の待ち時間(ms)
+  unsigned long deadline = 0;           // 要求を受け付けてから打ち切るまでの時間(ms)。0 なら回数だけで打ち切る
+
+  // attempt 回目の失敗の後、再送するまでの待ち時間(ms)。random はゆらぎに使う乱数
+  unsigned long getDelay(RetryReason reason, byte attempt, uint32_t random) const;
+
+  static uint32_t nextRandom(uint32_t *state); // xorshift32
+};
+
+#endif
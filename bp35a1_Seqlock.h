@@ -0,0 +1,92 @@
+#ifndef BP35A1_SEQLOCK_H_
+#define BP35A1_SEQLOCK_H_
+
+#include "bp35a1_Platform.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// 書き込み側が 1 つのスレッド(タスク)に限られるシーケンスロック
+// 書き込み側は待たされず、読み出し側は書き込みと重なったら読み直す
+// 値は 32 ビットのアトミック変数に分けて保持するので、書き込み中に読んでもデータ競合にならない
+template <typename T>
+class Seqlock
+{
+  static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+
+public:
+  Seqlock()
+  {
+    for (auto &word : _words)
+    {
+      word.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // 書き込み側
+  void store(const T &value)
+  {
+    uint32_t words[WORD_COUNT] = {};
+    memcpy(words, &value, sizeof(T));
+
+    uint32_t sequence = _sequence.load(std::memory_order_relaxed);
+    _sequence.store(sequence + 1, std::memory_order_relaxed); // 奇数の間は書き込み中
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < WORD_COUNT; i++)
+    {
+      _words[i].store(words[i], std::memory_order_relaxed);
+    }
+    _sequence.store(sequence + 2, std::memory_order_release);
+  }
+
+  // 読み出し側: 書き込みと重なった場合は false を返し、value は不定
+  bool tryLoad(T *value) const
+  {
+    uint32_t before = _sequence.load(std::memory_order_acquire);
+    if (before & 1)
+    {
+      return false;
+    }
+    uint32_t words[WORD_COUNT];
+    for (size_t i = 0; i < WORD_COUNT; i++)
+    {
+      words[i] = _words[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (_sequence.load(std::memory_order_relaxed) != before)
+    {
+      return false;
+    }
+    memcpy(value, words, sizeof(T));
+    return true;
+  }
+
+  // 読み出し側: 一貫した値が読めるまで繰り返す
+  // 同じコアの優先度の低いタスクが書き込み中でも進めるよう、何度か失敗したら bp35a1Yield() で実行を譲る
+  T load() const
+  {
+    T value;
+    for (int i = 1; !tryLoad(&value); i++)
+    {
+      if (i % SPIN_COUNT == 0)
+      {
+        bp35a1Yield();
+      }
+    }
+    return value;
+  }
+
+  uint32_t getVersion() const { return _sequence.load(std::memory_order_acquire) / 2; } // 完了した store() の回数
+
+private:
+  static const size_t WORD_COUNT = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+  static const int SPIN_COUNT = 64;
+
+  std::atomic<uint32_t> _sequence{0};
+  std::array<std::atomic<uint32_t>, WORD_COUNT> _words;
+};
+
+#endif
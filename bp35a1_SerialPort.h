@@ -0,0 +1,94 @@
+#ifndef BP35A1_SERIAL_PORT_H_
+#define BP35A1_SERIAL_PORT_H_
+
+#include "bp35a1_Platform.h"
+
+#ifdef ARDUINO
+#include "HardwareSerial.h"
+#endif
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+// BP35A1 とつながるシリアルポート
+// Arduino の HardwareSerial のほか、ホストではエミュレータや Linux のシリアルデバイスを実装として使う
+class SerialPort
+{
+public:
+  virtual ~SerialPort() {}
+
+  virtual int available() = 0;                               // 読み出せるバイト数
+  virtual int read() = 0;                                    // 1 バイト読む。なければ -1
+  virtual size_t readBytes(char *buffer, size_t length) = 0; // 読み出せる分だけ読む
+  virtual size_t write(const byte *data, size_t size) = 0;
+
+  // 受信データが届くまで最大 timeoutMs 待つ。届いていれば true
+  virtual bool waitForData(unsigned long timeoutMs)
+  {
+    if (available() > 0)
+    {
+      return true;
+    }
+    delay(timeoutMs);
+    return available() > 0;
+  }
+
+  size_t write(byte c) { return write(&c, 1); }
+  size_t print(const char *str) { return write(reinterpret_cast<const byte *>(str), strlen(str)); }
+  size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)))
+  {
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (length < 0)
+    {
+      return 0;
+    }
+    return write(reinterpret_cast<const byte *>(buf), std::min(static_cast<size_t>(length), sizeof(buf) - 1));
+  }
+};
+
+// 受信データが届くまで最大 timeout(ms) 待つ。Port に waitForData() がなければ Clock で待つ
+template <typename Clock, typename Port>
+auto waitForSerialData(Port *port, unsigned long timeout, int) -> decltype(port->waitForData(timeout))
+{
+  return port->waitForData(timeout);
+}
+
+template <typename Clock, typename Port>
+bool waitForSerialData(Port *port, unsigned long timeout, long)
+{
+  Clock::sleep(timeout);
+  return port->available() > 0;
+}
+
+template <typename Clock, typename Port>
+bool waitForSerialData(Port *port, unsigned long timeout)
+{
+  return waitForSerialData<Clock>(port, timeout, 0);
+}
+
+#ifdef ARDUINO
+// HardwareSerial を SerialPort として使うアダプタ
+class HardwareSerialPort : public SerialPort
+{
+public:
+  HardwareSerialPort() {}
+  explicit HardwareSerialPort(HardwareSerial *serial) : _serial(serial) {}
+
+  int available() override { return _serial->available(); }
+  int read() override { return _serial->read(); }
+  size_t readBytes(char *buffer, size_t length) override { return _serial->readBytes(buffer, length); }
+  size_t write(const byte *data, size_t size) override { return _serial->write(data, size); }
+  using SerialPort::write;
+
+private:
+  HardwareSerial *_serial = nullptr;
+};
+#endif
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef BP35A1_SPSC_RING_H_
+#define BP35A1_SPSC_RING_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+
+// 書き込み側・読み出し側がそれぞれ 1 つのスレッド(タスク)に限られるロックフリーのリングバッファ
+// Capacity は 2 のべき乗。位置は折り返さずに増やし続け、差で使用量を求める
+template <size_t Capacity>
+class SpscRing
+{
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+  // 書き込み側: 入るだけ書き込み、書き込んだバイト数を返す
+  size_t write(const char *data, size_t length)
+  {
+    size_t tail = _tail.load(std::memory_order_relaxed);
+    size_t head = _head.load(std::memory_order_acquire);
+    length = std::min(length, Capacity - (tail - head));
+    size_t pos = tail & (Capacity - 1);
+    size_t first = std::min(length, Capacity - pos);
+    std::copy(data, data + first, _buffer + pos);
+    std::copy(data + first, data + length, _buffer);
+    _tail.store(tail + length, std::memory_order_release);
+    return length;
+  }
+
+  // 読み出し側: 溜まっている分を最大 length バイト読み出す
+  size_t read(char *data, size_t length)
+  {
+    size_t head = _head.load(std::memory_order_relaxed);
+    size_t tail = _tail.load(std::memory_order_acquire);
+    length = std::min(length, tail - head);
+    size_t pos = head & (Capacity - 1);
+    size_t first = std::min(length, Capacity - pos);
+    std::copy(_buffer + pos, _buffer + pos + first, data);
+    std::copy(_buffer, _buffer + (length - first), data + first);
+    _head.store(head + length, std::memory_order_release);
+    return length;
+  }
+
+  size_t size() const { return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire); }
+  size_t space() const { return Capacity - size(); }
+  bool empty() const { return size() == 0; }
+
+private:
+  char _buffer[Capacity];
+  std::atomic<size_t> _head{0}; // 読み出し側だけが進める
+  std::atomic<size_t> _tail{0}; // 書き込み側だけが進める
+};
+
+#endif
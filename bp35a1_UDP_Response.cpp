@@ -2,103 +2,75 @@
 
 const int BP35A1UdpResponse::NO_DATA = 0xFFFFFFFE;
 
-Coefficient::Coefficient(std::string data)
+Coefficient::Coefficient(const byte *edt)
 {
-  _coefficient = strtol(data.c_str(), NULL, 16);
+  _coefficient = readUint32(edt);
 }
 
-TotalPower::TotalPower(std::string data)
+TotalPower::TotalPower(const byte *edt)
 {
-  _totalPower = strtol(data.c_str(), NULL, 16);
+  _totalPower = readUint32(edt);
 }
 
-PowerUnit::PowerUnit(std::string data)
+PowerUnit::PowerUnit(const byte *edt)
 {
-  _powerUnit = convertPowerUnit(data.substr(0, 2));
+  _powerUnit = convertPowerUnit(edt[0]);
 }
 
-float PowerUnit::convertPowerUnit(std::string stringUnit)
+float PowerUnit::convertPowerUnit(byte unit)
 {
-  if (stringUnit == "00")
+  switch (unit)
   {
+  case 0x00:
     return 1.0f;
-  }
-  else if (stringUnit == "01")
-  {
+  case 0x01:
     return 0.1f;
-  }
-  else if (stringUnit == "02")
-  {
+  case 0x02:
     return 0.01f;
-  }
-  else if (stringUnit == "03")
-  {
+  case 0x03:
     return 0.001f;
-  }
-  else if (stringUnit == "04")
-  {
+  case 0x04:
     return 0.0001f;
-  }
-  else if (stringUnit == "0A")
-  {
+  case 0x0A:
     return 10.0f;
-  }
-  else if (stringUnit == "0B")
-  {
+  case 0x0B:
     return 100.0f;
-  }
-  else if (stringUnit == "0C")
-  {
+  case 0x0C:
     return 1000.0f;
-  }
-  else if (stringUnit == "0D")
-  {
+  case 0x0D:
     return 10000.0f;
-  }
-  else
-  {
+  default:
     return 0.0f;
   }
 }
 
-TotalPowerHistories::TotalPowerHistories(std::string data)
+TotalPowerHistories::TotalPowerHistories(const byte *edt)
 {
-  std::string days = data.substr(0, 4);
-  _day = strtol(days.c_str(), NULL, 16);
-  std::string stringPowers = data.substr(4, 384);
-  std::string power;
+  _day = readUint16(edt);
   for (int i = 0; i < 48; i++)
   {
-    power = stringPowers.substr(i * 8, 8);
-    _powers[i] = strtol(power.c_str(), NULL, 16);
+    _powers[i] = readUint32(edt + 2 + i * 4);
   }
 }
 
-CollectionDay::CollectionDay(std::string data)
+CollectionDay::CollectionDay(const byte *edt)
 {
-  _day = strtol(data.c_str(), NULL, 16);
+  _day = edt[0];
 }
 
-InstantaneousPower::InstantaneousPower(std::string data)
+InstantaneousPower::InstantaneousPower(const byte *edt)
 {
-  _power = static_cast<int>(strtoul(data.c_str(), NULL, 16));
+  _power = static_cast<int>(readUint32(edt));
 }
 
-InstantaneousAmperage::InstantaneousAmperage(std::string data)
+InstantaneousAmperage::InstantaneousAmperage(const byte *edt)
 {
-  _amperageR = strtol(data.substr(0, 4).c_str(), NULL, 16);
-  _amperageT = strtol(data.substr(4, 4).c_str(), NULL, 16);
+  _amperageR = readUint16(edt);
+  _amperageT = readUint16(edt + 2);
 }
 
-CurrentTotalPower::CurrentTotalPower(std::string data)
+CurrentTotalPower::CurrentTotalPower(const byte *edt)
 {
-  std::string date = data.substr(0, 14);
-  int year = strtol(date.substr(0, 4).c_str(), NULL, 16);
-  int month = strtol(date.substr(4, 2).c_str(), NULL, 16);
-  int day = strtol(date.substr(6, 2).c_str(), NULL, 16);
-  int hour = strtol(date.substr(8, 2).c_str(), NULL, 16);
-  int minute = strtol(date.substr(10, 2).c_str(), NULL, 16);
-  int second = strtol(date.substr(12, 2).c_str(), NULL, 16);
-
-  _totalPower = strtol(data.substr(14, 8).c_str(), NULL, 16);
+  // 先頭 7 バイトは計測日時(年2, 月, 日, 時, 分, 秒)
+  _totalPower = readUint32(edt + 7);
 }
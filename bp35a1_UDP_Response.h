@@ -1,25 +1,32 @@
 #ifndef BP35A1_UDP_RESPONSE_H_
 #define BP35A1_UDP_RESPONSE_H_
 
-#include "Arduino.h"
-
-#include <iomanip>
-#include <sstream>
+#include "bp35a1_Platform.h"
 
+// 各クラスは受信フレーム内の EDT (バイナリ) から構築する
+// dataLength() は EDT のバイト数
 class BP35A1UdpResponse
 {
 public:
   BP35A1UdpResponse() {}
   static const int NO_DATA;
+
+protected:
+  static uint16_t readUint16(const byte *data) { return (data[0] << 8) | data[1]; }
+  static uint32_t readUint32(const byte *data)
+  {
+    return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) |
+           (static_cast<uint32_t>(data[2]) << 8) | static_cast<uint32_t>(data[3]);
+  }
 };
 
 class Coefficient : public BP35A1UdpResponse
 {
 public:
   Coefficient() {}
-  Coefficient(std::string data);
+  Coefficient(const byte *edt);
 
-  static int dataLength() { return 8; }
+  static int dataLength() { return 4; }
 
   int getCoefficient() { return _coefficient; }
 
@@ -31,9 +38,9 @@ class TotalPower : public BP35A1UdpResponse
 {
 public:
   TotalPower() {}
-  TotalPower(std::string data);
+  TotalPower(const byte *edt);
 
-  static int dataLength() { return 8; }
+  static int dataLength() { return 4; }
 
   int getTotalPower() { return _totalPower; }
 
@@ -45,14 +52,14 @@ class PowerUnit : public BP35A1UdpResponse
 {
 public:
   PowerUnit() {}
-  PowerUnit(std::string data);
+  PowerUnit(const byte *edt);
 
-  static int dataLength() { return 2; }
+  static int dataLength() { return 1; }
 
   float getPowerUnit() { return _powerUnit; }
 
 private:
-  static float convertPowerUnit(std::string stringUnit);
+  static float convertPowerUnit(byte unit);
 
   float _powerUnit = 0.f;
 };
@@ -61,9 +68,9 @@ class TotalPowerHistories : public BP35A1UdpResponse
 {
 public:
   TotalPowerHistories() {}
-  TotalPowerHistories(std::string data);
+  TotalPowerHistories(const byte *edt);
 
-  static int dataLength() { return 388; }
+  static int dataLength() { return 194; }
 
   int getDay() { return _day; }
   long *getPowers() { return _powers; }
@@ -77,9 +84,9 @@ class CollectionDay : public BP35A1UdpResponse
 {
 public:
   CollectionDay() {}
-  CollectionDay(std::string data);
+  CollectionDay(const byte *edt);
 
-  static int dataLength() { return 2; }
+  static int dataLength() { return 1; }
 
   byte getDay() { return _day; }
 
@@ -91,9 +98,9 @@ class InstantaneousPower : public BP35A1UdpResponse
 {
 public:
   InstantaneousPower() {}
-  InstantaneousPower(std::string data);
+  InstantaneousPower(const byte *edt);
 
-  static int dataLength() { return 8; }
+  static int dataLength() { return 4; }
 
   int getPower() { return _power; }
 
@@ -105,9 +112,9 @@ class InstantaneousAmperage : public BP35A1UdpResponse
 {
 public:
   InstantaneousAmperage() {}
-  InstantaneousAmperage(std::string data);
+  InstantaneousAmperage(const byte *edt);
 
-  static int dataLength() { return 8; }
+  static int dataLength() { return 4; }
 
   int getAmperageR() { return _amperageR; }
   int getAmperageT() { return _amperageT; }
@@ -129,9 +136,9 @@ class CurrentTotalPower : public BP35A1UdpResponse
 {
 public:
   CurrentTotalPower() {}
-  CurrentTotalPower(std::string data);
+  CurrentTotalPower(const byte *edt);
 
-  static int dataLength() { return 22; }
+  static int dataLength() { return 11; }
 
   long getTotalPower() { return _totalPower; }
 
@@ -0,0 +1,67 @@
+#include "bp35a1.h"
+
+#include <string>
+
+// 積算電力量計測値履歴(E2/E4)の EDT 194 バイト分の 16 進文字列をデコードする時間を比較する
+
+const int ITERATIONS = 1000;
+const size_t PAYLOAD_SIZE = 194;
+
+std::string payload;
+byte decoded[PAYLOAD_SIZE];
+
+// 以前の parseHexBytes() と同じ 1 バイトずつ substr + strtoul する実装
+bool legacyParseHexBytes(const std::string &hex, byte *out, size_t outSize)
+{
+  if (!out || hex.size() < outSize * 2)
+  {
+    return false;
+  }
+  for (size_t i = 0; i < outSize; ++i)
+  {
+    const std::string byteStr = hex.substr(i * 2, 2);
+    out[i] = static_cast<byte>(strtoul(byteStr.c_str(), NULL, 16));
+  }
+  return true;
+}
+
+bool decodeScalar(const std::string &hex, byte *out, size_t outSize)
+{
+  return HexDecoder::decodeScalar(hex.data(), out, outSize);
+}
+
+bool decode(const std::string &hex, byte *out, size_t outSize)
+{
+  return HexDecoder::decode(hex.data(), out, outSize);
+}
+
+void benchmark(const char *name, bool (*func)(const std::string &, byte *, size_t))
+{
+  unsigned long start = micros();
+  for (int i = 0; i < ITERATIONS; i++)
+  {
+    func(payload, decoded, PAYLOAD_SIZE);
+  }
+  unsigned long elapsed = micros() - start;
+  Serial.printf("%-12s %8.2f us/decode\n", name, static_cast<float>(elapsed) / ITERATIONS);
+}
+
+void setup()
+{
+  Serial.begin(115200);
+
+  // 収集日 + 48 コマ分の積算電力量
+  const char *digits = "0123456789ABCDEF";
+  for (size_t i = 0; i < PAYLOAD_SIZE * 2; i++)
+  {
+    payload += digits[(i * 7) % 16];
+  }
+
+  benchmark("legacy", legacyParseHexBytes);
+  benchmark("table", decodeScalar);
+  benchmark("table+SWAR", decode);
+}
+
+void loop()
+{
+}
@@ -107,8 +107,8 @@ void setup()
   }
 
   Serial.println("Wi-SUN connected!!!");
-  bp35a1.requestCoefficient();
-  bp35a1.requestPowerUnit();
+  // 係数と単位は 1 回の要求でまとめて取得する
+  bp35a1.getProperties({CmdType::COEFFICIENT, CmdType::POWER_UNIT});
 
   M5.Lcd.fillScreen(BLACK);
   pinMode(10, OUTPUT);
@@ -150,11 +150,10 @@ void drawProgressiveBar(uint16_t y, uint16_t height, int value, int maxValue)
 
 void updateInstantaneousValue()
 {
-  bp35a1.requestInstantaneousPower();
+  bp35a1.getProperties({CmdType::INSTANTANEOUS_POWER, CmdType::INSTANTANEOUS_AMPERAGE});
   int watt = bp35a1.getInstantaneousPower();
   updateInstantaneousWatt(watt);
 
-  bp35a1.requestInstantaneousAmperage();
   InstantaneousAmperage amperage = bp35a1.getInstantaneousAmperage();
   updateInstantaneousAmperage(amperage);
 }
@@ -7,6 +7,7 @@ const char *BID = "YOUR_B_ROUTE_ID";
 const char *BPWD = "YOUR_B_ROUTE_PWD";
 
 BP35A1 bp35a1;
+PreferencesConnectionStore store; // 前回接続した PAN の情報
 
 bool connectWiSun(const char *id, const char *password)
 {
@@ -36,6 +37,12 @@ bool connectWiSun(const char *id, const char *password)
     return false;
   }
 
+  // 前回の PAN に接続できればスキャンを省く
+  if (bp35a1.restoreConnection(&store))
+  {
+    return true;
+  }
+
   // Wi-SUN チャンネルスキャン
   if (!bp35a1.scanChannel())
   {
@@ -72,6 +79,7 @@ bool connectWiSun(const char *id, const char *password)
     return false;
   }
 
+  bp35a1.saveConnection(&store);
   return true;
 }
 
@@ -92,8 +100,8 @@ void setup()
   }
 
   Serial.println("Wi-SUN connected!!!");
-  bp35a1.requestCoefficient();
-  bp35a1.requestPowerUnit();
+  // 係数と単位は 1 回の要求でまとめて取得する
+  bp35a1.getProperties({CmdType::COEFFICIENT, CmdType::POWER_UNIT});
 
   pinMode(10, OUTPUT);
 }
@@ -0,0 +1,68 @@
+// エミュレータのメーター数を増やしながら BasicConcentrator の取得件数/秒を測る
+// 使い方: ConcentratorBenchmark [最大メーター数] [測定時間(s)] [RTT(ms)]
+
+#include "bp35a1_Concentrator.h"
+#include "bp35a1_Emulator.h"
+
+#include <cstdlib>
+#include <memory>
+
+int main(int argc, char *argv[])
+{
+  size_t maxMeters = argc > 1 ? strtoul(argv[1], nullptr, 10) : 16;
+  unsigned long duration = (argc > 2 ? strtoul(argv[2], nullptr, 10) : 10) * 1000;
+  unsigned long rtt = argc > 3 ? strtoul(argv[3], nullptr, 10) : 1000;
+
+  printf("meters  connect[ms]  readings  failed  readings/s  per meter\n");
+  for (size_t meters = 1; meters <= maxMeters && meters <= BP35A1_MAX_LINKS; meters *= 2)
+  {
+    std::vector<std::unique_ptr<BP35A1Emulator>> emulators;
+    std::vector<std::unique_ptr<BasicBP35A1<BP35A1Emulator>>> devices;
+    BasicConcentrator<BP35A1Emulator> concentrator;
+    for (size_t i = 0; i < meters; i++)
+    {
+      EmulatorConfig config;
+      config.scanTime = 300;
+      config.joinTime = 1000;
+      config.rtt = rtt;
+      config.jitter = rtt / 4;
+      config.seed = i + 1;
+      emulators.push_back(std::unique_ptr<BP35A1Emulator>(new BP35A1Emulator(config)));
+      devices.push_back(std::unique_ptr<BasicBP35A1<BP35A1Emulator>>(new BasicBP35A1<BP35A1Emulator>(emulators.back().get())));
+      concentrator.addLink(devices.back().get(), "ID", "PASSWORD");
+    }
+    // 1 つの Get 要求にまとまる 4 プロパティを、応答が届きしだい取り直す
+    concentrator.addPollProperty(CmdType::INSTANTANEOUS_POWER, 100);
+    concentrator.addPollProperty(CmdType::INSTANTANEOUS_AMPERAGE, 100);
+    concentrator.addPollProperty(CmdType::TOTAL_POWER, 100);
+    concentrator.addPollProperty(CmdType::CURRENT_TOTAL_POWER, 100);
+
+    unsigned long start = millis();
+    concentrator.begin();
+    while (concentrator.getConnectedCount() < meters && millis() - start < 60000)
+    {
+      concentrator.poll();
+      delay(1);
+    }
+    unsigned long connected = millis() - start;
+
+    unsigned long succeeded = 0;
+    unsigned long failed = 0;
+    concentrator.setReadingCallback([&](size_t link, CmdType command, CommandStatus status)
+                                    {
+                                      if (status == CommandStatus::SUCCEEDED)
+                                        succeeded++;
+                                      else
+                                        failed++;
+                                    });
+    start = millis();
+    while (millis() - start < duration)
+    {
+      concentrator.poll();
+      delay(1);
+    }
+    double rate = succeeded * 1000.0 / duration;
+    printf("%6zu  %11lu  %8lu  %6lu  %10.1f  %9.1f\n", meters, connected, succeeded, failed, rate, rate / meters);
+  }
+  return 0;
+}
@@ -0,0 +1,67 @@
+// エミュレータにつないで接続から定期取得までを Linux 上で実行する
+// 使い方: EmulatorDemo [RTT(ms)] [損失率] [実行時間(s)]
+
+#include "bp35a1.h"
+#include "bp35a1_Emulator.h"
+
+#include <cstdlib>
+
+int main(int argc, char *argv[])
+{
+  EmulatorConfig config;
+  config.scanTime = 200;
+  config.joinTime = 200;
+  config.rtt = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000;
+  config.jitter = config.rtt / 4;
+  config.loss = argc > 2 ? atof(argv[2]) : 0.0;
+  unsigned long duration = (argc > 3 ? strtoul(argv[3], nullptr, 10) : 30) * 1000;
+
+  BP35A1Emulator emulator(config);
+  BasicBP35A1<BP35A1Emulator> bp35a1(&emulator);
+
+  bp35a1.clearBuffer();
+  if (!bp35a1.assureAsciiMode() || !bp35a1.setPassword("PASSWORD") || !bp35a1.setId("ID") ||
+      !bp35a1.scanChannel() || !bp35a1.getIpv6Address() || !bp35a1.setChannel() || !bp35a1.setPanId() ||
+      !bp35a1.requestAndWaitConnection())
+  {
+    printf("connect failed\n");
+    return 1;
+  }
+  printf("connected\n");
+
+  if (!bp35a1.discoverProperties())
+  {
+    printf("discover properties failed\n");
+    return 1;
+  }
+  bp35a1.getProperties({CmdType::COEFFICIENT, CmdType::POWER_UNIT});
+
+  unsigned long succeeded = 0;
+  unsigned long failed = 0;
+  bp35a1.setPollCallback([&](CmdType command, CommandStatus status)
+                         {
+                           if (status != CommandStatus::SUCCEEDED)
+                           {
+                             failed++;
+                             return;
+                           }
+                           succeeded++;
+                           if (command == CmdType::INSTANTANEOUS_POWER)
+                             printf("%lu: %d[W]\n", millis(), bp35a1.getInstantaneousPower());
+                         });
+  bp35a1.addPollProperty(CmdType::INSTANTANEOUS_POWER, 1000);
+  bp35a1.addPollProperty(CmdType::INSTANTANEOUS_AMPERAGE, 1000);
+  bp35a1.addPollProperty(CmdType::CURRENT_TOTAL_POWER, 10000);
+
+  unsigned long start = millis();
+  while (millis() - start < duration)
+  {
+    bp35a1.poll();
+    delay(1);
+  }
+
+  const BP35A1Emulator::Stats &stats = emulator.getStats();
+  printf("properties: %lu succeeded, %lu failed\n", succeeded, failed);
+  printf("requests: %lu, responses: %lu, dropped: %lu\n", stats.requests, stats.responses, stats.dropped);
+  return 0;
+}
@@ -0,0 +1,63 @@
+// 疑似端末(pty)の先で BP35A1Emulator を動かす
+// 表示されたスレーブ側のパスを LinuxSerialPort で開くと、実機の USB-UART と同じように試験できる
+// 使い方: PtyEmulator [RTT(ms)] [損失率]
+
+#include "bp35a1_Emulator.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+int main(int argc, char *argv[])
+{
+  EmulatorConfig config;
+  config.scanTime = 500;
+  config.joinTime = 500;
+  config.rtt = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000;
+  config.jitter = config.rtt / 4;
+  config.loss = argc > 2 ? atof(argv[2]) : 0.0;
+  BP35A1Emulator emulator(config);
+
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+  {
+    perror("posix_openpt");
+    return 1;
+  }
+  fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+  printf("%s\n", ptsname(master));
+  fflush(stdout);
+
+  char buffer[1024];
+  while (true)
+  {
+    pollfd fd = {master, POLLIN, 0};
+    poll(&fd, 1, 1);
+
+    ssize_t size = ::read(master, buffer, sizeof(buffer));
+    if (size > 0)
+    {
+      emulator.write(reinterpret_cast<const byte *>(buffer), size);
+    }
+    else if (size < 0 && errno != EAGAIN && errno != EIO)
+    {
+      perror("read");
+      return 1;
+    }
+
+    while (emulator.available() > 0)
+    {
+      size_t length = emulator.readBytes(buffer, sizeof(buffer));
+      for (size_t written = 0; written < length;)
+      {
+        ssize_t result = ::write(master, buffer + written, length - written);
+        if (result > 0)
+          written += result;
+        else if (errno != EAGAIN && errno != EINTR)
+          break;
+      }
+    }
+  }
+}
@@ -0,0 +1,610 @@
+#include "bp35a1_Emulator.h"
+
+#include <algorithm>
+#include <array>
+#include <sstream>
+
+namespace
+{
+  const char *OWN_IPV6 = "FE80:0000:0000:0000:021D:1290:0000:0001"; // エミュレートする BP35A1 自身のアドレス
+
+  std::vector<std::string> split(const std::string &str)
+  {
+    std::vector<std::string> tokens;
+    std::istringstream stream(str);
+    std::string token;
+    while (stream >> token)
+    {
+      tokens.push_back(token);
+    }
+    return tokens;
+  }
+
+  std::string toHex(const byte *data, size_t size)
+  {
+    static const char DIGITS[] = "0123456789ABCDEF";
+    std::string hex;
+    hex.reserve(size * 2);
+    for (size_t i = 0; i < size; i++)
+    {
+      hex += DIGITS[data[i] >> 4];
+      hex += DIGITS[data[i] & 0x0F];
+    }
+    return hex;
+  }
+
+  // MAC アドレスから IPv6 リンクローカルアドレスを作る(U/L ビットを反転する)
+  std::string linkLocalAddress(const std::string &mac)
+  {
+    if (mac.size() != 16)
+    {
+      return "";
+    }
+    std::string address = "FE80:0000:0000:0000:";
+    for (size_t i = 0; i < 16; i += 4)
+    {
+      std::string group = mac.substr(i, 4);
+      if (i == 0)
+      {
+        byte first = std::stoi(group.substr(0, 2), nullptr, 16) ^ 0x02;
+        group = toHex(&first, 1) + group.substr(2);
+      }
+      address += group;
+      if (i < 12)
+      {
+        address += ':';
+      }
+    }
+    return address;
+  }
+}
+
+BP35A1Emulator::BP35A1Emulator(const EmulatorConfig &config) : _config(config), _random(config.seed != 0 ? config.seed : 1)
+{
+  _binary = config.binaryErxudp;
+
+  // 低圧スマート電力量メータの代表的な値
+  _properties[0x80] = {0x30};                                       // 動作状態
+  _properties[0x88] = {0x42};                                       // 異常発生状態
+  _properties[0x8A] = {0x00, 0x00, 0x16};                           // メーカコード
+  _properties[0xD3] = {0x00, 0x00, 0x00, 0x01};                     // 係数
+  _properties[0xD7] = {0x06};                                       // 有効桁数
+  _properties[0xE0] = {0x00, 0x00, 0x30, 0x39};                     // 積算電力量計測値
+  _properties[0xE1] = {0x01};                                       // 単位 0.1kWh
+  _properties[0xE3] = {0x00, 0x00, 0x00, 0x00};                     // 積算電力量計測値(逆方向)
+  _properties[0xE5] = {0x00};                                       // 積算履歴収集日
+  _properties[0xE7] = {0x00, 0x00, 0x01, 0xF4};                     // 瞬時電力 500W
+  _properties[0xE8] = {0x00, 0x32, 0x00, 0x14};                     // 瞬時電流 R 5.0A, T 2.0A
+  _properties[0xEA] = {0x07, 0xEA, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x39}; // 定時積算電力量
+  std::vector<byte> histories(194, 0x00);
+  for (size_t i = 0; i < 48; i++)
+  {
+    histories[2 + i * 4 + 3] = i;
+  }
+  _properties[0xE2] = histories; // 積算電力量計測値履歴
+  _settable[0xE5] = true;
+  updatePropertyMaps();
+}
+
+int BP35A1Emulator::available()
+{
+  pump();
+  return _rx.size();
+}
+
+int BP35A1Emulator::read()
+{
+  pump();
+  if (_rx.empty())
+  {
+    return -1;
+  }
+  char c = _rx.front();
+  _rx.pop_front();
+  return static_cast<byte>(c);
+}
+
+size_t BP35A1Emulator::readBytes(char *buffer, size_t length)
+{
+  pump();
+  size_t size = std::min(length, _rx.size());
+  std::copy(_rx.begin(), _rx.begin() + size, buffer);
+  _rx.erase(_rx.begin(), _rx.begin() + size);
+  return size;
+}
+
+size_t BP35A1Emulator::write(const byte *data, size_t size)
+{
+  _input.append(reinterpret_cast<const char *>(data), size);
+  handleInput();
+  return size;
+}
+
+void BP35A1Emulator::setProperty(byte epc, const std::vector<byte> &edt)
+{
+  _properties[epc] = edt;
+  updatePropertyMaps();
+}
+
+void BP35A1Emulator::removeProperty(byte epc)
+{
+  _properties.erase(epc);
+  _settable.erase(epc);
+  updatePropertyMaps();
+}
+
+void BP35A1Emulator::setSettable(byte epc, bool settable)
+{
+  _settable[epc] = settable;
+  updatePropertyMaps();
+}
+
+bool BP35A1Emulator::getProperty(byte epc, std::vector<byte> *edt) const
+{
+  if (_handler && _handler(epc, edt))
+  {
+    return true;
+  }
+  auto it = _properties.find(epc);
+  if (it == _properties.end())
+  {
+    return false;
+  }
+  *edt = it->second;
+  return true;
+}
+
+void BP35A1Emulator::schedule(unsigned long delayMs, const std::string &line)
+{
+  reply(delayMs, line);
+}
+
+void BP35A1Emulator::triggerReauthentication()
+{
+  std::string ipv6 = getIpv6Address();
+  _stats.reauthentications++;
+  authenticate();
+  reply(0, "EVENT 29 " + ipv6);
+  reply(_config.joinTime, "EVENT 25 " + ipv6);
+}
+
+void BP35A1Emulator::notify(const std::vector<byte> &epcs, bool confirmed)
+{
+  std::vector<byte> frame = {0x10, 0x81, static_cast<byte>(_notificationTid >> 8), static_cast<byte>(_notificationTid & 0xFF),
+                             0x02, 0x88, 0x01, 0x05, 0xFF, 0x01, static_cast<byte>(confirmed ? 0x74 : 0x73), 0x00};
+  _notificationTid++;
+  for (byte epc : epcs)
+  {
+    std::vector<byte> value;
+    if (!getProperty(epc, &value))
+    {
+      continue;
+    }
+    frame.push_back(epc);
+    frame.push_back(value.size());
+    frame.insert(frame.end(), value.begin(), value.end());
+    frame[11]++;
+  }
+  _stats.notifications++;
+  reply(0, erxudp(frame));
+}
+
+void BP35A1Emulator::authenticate()
+{
+  _authenticatedAt = millis() + _config.joinTime;
+  _reauthUntil = _authenticatedAt;
+}
+
+std::string BP35A1Emulator::getIpv6Address() const
+{
+  return linkLocalAddress(_config.macAddress);
+}
+
+void BP35A1Emulator::pump()
+{
+  unsigned long now = millis();
+  // 有効期限が来るとモジュールが自分で再認証する
+  if (_connected && _sessionLifetime != 0 && static_cast<long>(now - _authenticatedAt) >= static_cast<long>(_sessionLifetime * 1000))
+  {
+    triggerReauthentication();
+  }
+  size_t released = 0;
+  for (const auto &output : _output)
+  {
+    if (static_cast<long>(now - output.time) < 0)
+    {
+      break;
+    }
+    _rx.insert(_rx.end(), output.data.begin(), output.data.end());
+    released++;
+  }
+  _output.erase(_output.begin(), _output.begin() + released);
+}
+
+void BP35A1Emulator::handleInput()
+{
+  while (!_input.empty())
+  {
+    if (_input.compare(0, 9, "SKSENDTO ") == 0)
+    {
+      // SKSENDTO <HANDLE> <IPADDR> <PORT> <SEC> [<SIDE>] <DATALEN> <DATA>
+      // データ部はバイナリなので DATALEN を読んでから必要なバイト数がそろうのを待つ
+      std::vector<size_t> spaces;
+      for (size_t i = 0; i < _input.size() && spaces.size() < 7; i++)
+      {
+        if (_input[i] == ' ')
+        {
+          spaces.push_back(i);
+        }
+      }
+      if (spaces.size() < 6)
+      {
+        return;
+      }
+      std::vector<std::string> tokens = split(_input.substr(0, spaces[5]));
+      size_t lengthIndex = 5;
+      if (tokens[5].size() != 4)
+      {
+        if (spaces.size() < 7)
+        {
+          return;
+        }
+        tokens = split(_input.substr(0, spaces[6]));
+        lengthIndex = 6;
+      }
+      size_t length = std::stoul(tokens[lengthIndex], nullptr, 16);
+      size_t start = spaces[lengthIndex] + 1;
+      if (_input.size() < start + length)
+      {
+        return;
+      }
+      std::string data = _input.substr(start, length);
+      _input.erase(0, start + length);
+      handleSendTo(tokens, data);
+      continue;
+    }
+
+    size_t end = _input.find_first_of("\r\n");
+    if (end == std::string::npos)
+    {
+      return;
+    }
+    std::string command = _input.substr(0, end);
+    _input.erase(0, end + 1);
+    if (!command.empty())
+    {
+      handleCommand(command);
+    }
+  }
+}
+
+void BP35A1Emulator::handleCommand(const std::string &command)
+{
+  std::vector<std::string> tokens = split(command);
+  if (tokens.empty())
+  {
+    return;
+  }
+  _stats.commands++;
+  const std::string &name = tokens[0];
+  std::string ipv6 = getIpv6Address();
+
+  if (name == "SKVER")
+  {
+    reply(_config.commandDelay, "EVER 1.2.10");
+    reply(_config.commandDelay, "OK");
+  }
+  else if (name == "SKSREG" || name == "SKSETPWD")
+  {
+    if (name == "SKSREG" && tokens.size() >= 3 && tokens[1] == "S16")
+    {
+      _sessionLifetime = std::stoul(tokens[2], nullptr, 16);
+    }
+    reply(_config.commandDelay, "OK");
+  }
+  else if (name == "SKSETRBID" && tokens.size() >= 2)
+  {
+    const std::string &id = tokens[1];
+    _pairId = id.substr(id.size() > 8 ? id.size() - 8 : 0);
+    reply(_config.commandDelay, "OK");
+  }
+  else if (name == "ROPT")
+  {
+    reply(_config.commandDelay, _binary ? "OK 00" : "OK 01");
+  }
+  else if (name == "WOPT" && tokens.size() >= 2)
+  {
+    _binary = tokens[1] == "00";
+    reply(_config.commandDelay, "OK");
+  }
+  else if (name == "SKTERM")
+  {
+    if (!_connected)
+    {
+      reply(_config.commandDelay, "FAIL ER10");
+      return;
+    }
+    _connected = false;
+    reply(_config.commandDelay, "OK");
+    reply(_config.commandDelay, "EVENT 27 " + ipv6);
+  }
+  else if (name == "SKSCAN")
+  {
+    reply(_config.commandDelay, "OK");
+    // SKSCAN 2 <チャンネルマスク> <duration> 0。ビット 0 がチャンネル 33(0x21)
+    uint32_t mask = tokens.size() >= 3 ? std::stoul(tokens[2], nullptr, 16) : 0xFFFFFFFF;
+    unsigned long channel = std::stoul(_config.channel, nullptr, 16);
+    bool inMask = channel >= 33 && channel <= 60 && (mask & (1UL << (channel - 33))) != 0;
+    if (inMask && _scanCount++ >= _config.scanMisses)
+    {
+      auto describe = [this](const std::string &panId, const std::string &addr, const std::string &lqi, const std::string &pairId)
+      {
+        reply(_config.scanTime, std::string("EVENT 20 ") + OWN_IPV6);
+        reply(_config.scanTime, "EPANDESC");
+        reply(_config.scanTime, "  Channel:" + _config.channel);
+        reply(_config.scanTime, "  Channel Page:09");
+        reply(_config.scanTime, "  Pan ID:" + panId);
+        reply(_config.scanTime, "  Addr:" + addr);
+        reply(_config.scanTime, "  LQI:" + lqi);
+        reply(_config.scanTime, "  PairID:" + pairId);
+      };
+      describe(_config.panId, _config.macAddress, _config.lqi, _pairId);
+      for (unsigned int i = 0; i < _config.neighbours; i++)
+      {
+        char suffix[9];
+        snprintf(suffix, sizeof(suffix), "%02X", i & 0xFF);
+        describe("99" + std::string(suffix), "001D1290ABCDEF" + std::string(suffix), "F0", "FFFFFF" + std::string(suffix));
+      }
+    }
+    reply(_config.scanTime, std::string("EVENT 22 ") + OWN_IPV6);
+  }
+  else if (name == "SKLL64" && tokens.size() >= 2)
+  {
+    reply(_config.commandDelay, linkLocalAddress(tokens[1]));
+  }
+  else if (name == "SKJOIN")
+  {
+    reply(_config.commandDelay, "OK");
+    reply(_config.commandDelay, "EVENT 21 " + ipv6 + " 00");
+    // 別の PAN(近隣の家のメーター)には接続できない
+    bool otherMeter = tokens.size() >= 2 && tokens[1] != ipv6;
+    if (_failNextJoin || otherMeter)
+    {
+      _failNextJoin = false;
+      _connected = false;
+      reply(_config.joinTime, "EVENT 24 " + ipv6);
+      return;
+    }
+    _connected = true;
+    authenticate();
+    _reauthUntil = 0;
+    reply(_config.joinTime, "EVENT 25 " + ipv6);
+  }
+  else if (name == "SKREJOIN")
+  {
+    if (!_connected)
+    {
+      reply(_config.commandDelay, "FAIL ER10");
+      return;
+    }
+    _stats.rejoins++;
+    authenticate();
+    reply(_config.commandDelay, "OK");
+    reply(_config.joinTime, "EVENT 25 " + ipv6);
+  }
+  else
+  {
+    reply(_config.commandDelay, "FAIL ER04");
+  }
+}
+
+void BP35A1Emulator::handleSendTo(const std::vector<std::string> &tokens, const std::string &data)
+{
+  _stats.commands++;
+  if (!_connected)
+  {
+    reply(_config.commandDelay, "FAIL ER10");
+    return;
+  }
+  // 引数の検査: HANDLE は接続したセッション(1)、DATALEN は 1 〜 0x4D0 バイト
+  size_t length = std::stoul(tokens.back(), nullptr, 16);
+  if (tokens[1] != "1" || length == 0 || length > 0x4D0)
+  {
+    reply(_config.commandDelay, "FAIL ER06");
+    return;
+  }
+  std::string ipv6 = getIpv6Address();
+  if (_config.sendFailure > 0.0 && random(1000000) < _config.sendFailure * 1000000)
+  {
+    _stats.sendFailures++;
+    reply(_config.commandDelay, "EVENT 21 " + ipv6 + " 01");
+    reply(_config.commandDelay, "OK");
+    return;
+  }
+  reply(_config.commandDelay, "EVENT 21 " + ipv6 + " 00");
+  reply(_config.commandDelay, "OK");
+
+  if (tokens[3] != "0E1A")
+  {
+    // ECHONET Lite のポート(3610)以外にはメーターは応答しない
+    return;
+  }
+  _stats.requests++;
+  std::vector<byte> response = respond(std::vector<byte>(data.begin(), data.end()));
+  if (response.empty())
+  {
+    return;
+  }
+  if (_config.loss > 0.0 && random(1000000) < _config.loss * 1000000)
+  {
+    _stats.dropped++;
+    return;
+  }
+  _stats.responses++;
+  unsigned long delay = _config.rtt + random(_config.jitter + 1);
+  unsigned long now = millis();
+  if (static_cast<long>(_reauthUntil - now) > 0)
+  {
+    // 再認証が終わるまで応答は届かない
+    delay += _reauthUntil - now;
+  }
+  reply(delay, erxudp(response));
+}
+
+std::vector<byte> BP35A1Emulator::respond(const std::vector<byte> &request)
+{
+  static const byte METER_EOJ[] = {0x02, 0x88, 0x01};
+  if (request.size() < 12 || request[0] != 0x10 || request[1] != 0x81 ||
+      !std::equal(METER_EOJ, METER_EOJ + 3, request.begin() + 7))
+  {
+    return {};
+  }
+
+  byte esv = request[10];
+  if (esv == 0x7A)
+  {
+    // INFC_Res には応答しない
+    _stats.acknowledgements++;
+    return {};
+  }
+  if (esv != 0x62 && esv != 0x61 && esv != 0x60)
+  {
+    return {};
+  }
+
+  std::vector<byte> response = {0x10, 0x81, request[2], request[3], 0x02, 0x88, 0x01,
+                                request[4], request[5], request[6], static_cast<byte>(esv + 0x10), request[11]};
+  bool rejected = false;
+  size_t pos = 12;
+  for (int i = 0; i < request[11]; i++)
+  {
+    if (pos + 2 > request.size() || pos + 2 + request[pos + 1] > request.size())
+    {
+      return {};
+    }
+    byte epc = request[pos];
+    byte pdc = request[pos + 1];
+    std::vector<byte> edt(request.begin() + pos + 2, request.begin() + pos + 2 + pdc);
+    pos += 2 + pdc;
+
+    response.push_back(epc);
+    if (esv == 0x62)
+    {
+      std::vector<byte> value;
+      if (getProperty(epc, &value))
+      {
+        response.push_back(value.size());
+        response.insert(response.end(), value.begin(), value.end());
+      }
+      else
+      {
+        response.push_back(0);
+        rejected = true;
+      }
+    }
+    else if (_settable[epc])
+    {
+      _properties[epc] = edt;
+      response.push_back(0);
+    }
+    else
+    {
+      // 書き込めないプロパティは要求の EDT をそのまま返す
+      response.push_back(pdc);
+      response.insert(response.end(), edt.begin(), edt.end());
+      rejected = true;
+    }
+  }
+
+  if (rejected)
+  {
+    response[10] = esv - 0x10; // Get_SNA / SetC_SNA / SetI_SNA
+  }
+  else if (esv == 0x60)
+  {
+    return {}; // SetI は成功すると応答しない
+  }
+  return response;
+}
+
+std::string BP35A1Emulator::erxudp(const std::vector<byte> &frame) const
+{
+  char length[5];
+  snprintf(length, sizeof(length), "%04X", static_cast<unsigned int>(frame.size()));
+  std::string line = "ERXUDP " + getIpv6Address() + " " + OWN_IPV6 + " 0E1A 0E1A " + _config.macAddress + " 1 " + length + " ";
+  if (_binary)
+  {
+    line.append(frame.begin(), frame.end());
+  }
+  else
+  {
+    line += toHex(frame.data(), frame.size());
+  }
+  return line;
+}
+
+void BP35A1Emulator::reply(unsigned long delayMs, const std::string &line)
+{
+  Output output = {millis() + delayMs, line + "\r\n"};
+  // 同じ時刻の出力は予約した順に送る
+  auto it = std::upper_bound(_output.begin(), _output.end(), output, [](const Output &a, const Output &b)
+                             { return static_cast<long>(a.time - b.time) < 0; });
+  _output.insert(it, output);
+}
+
+unsigned long BP35A1Emulator::random(unsigned long range)
+{
+  // xorshift32
+  _random ^= _random << 13;
+  _random ^= _random >> 17;
+  _random ^= _random << 5;
+  return range == 0 ? 0 : _random % range;
+}
+
+void BP35A1Emulator::updatePropertyMaps()
+{
+  auto encode = [](const std::vector<byte> &epcs)
+  {
+    // 固定長の配列で組み立ててから、使った長さだけをコピーする
+    std::array<byte, 17> map = {};
+    map[0] = static_cast<byte>(epcs.size());
+    size_t length = 1;
+    if (epcs.size() < 16)
+    {
+      for (byte epc : epcs)
+      {
+        map[length++] = epc;
+      }
+    }
+    else
+    {
+      length = map.size();
+      for (byte epc : epcs)
+      {
+        map[1 + (epc & 0x0F)] |= 1 << ((epc >> 4) - 8);
+      }
+    }
+    return std::vector<byte>(map.begin(), map.begin() + length);
+  };
+
+  std::vector<byte> get = {0x9D, 0x9E, 0x9F};
+  std::vector<byte> set;
+  for (const auto &property : _properties)
+  {
+    if (property.first < 0x9D || property.first > 0x9F)
+    {
+      get.push_back(property.first);
+    }
+  }
+  for (const auto &settable : _settable)
+  {
+    if (settable.second)
+    {
+      set.push_back(settable.first);
+    }
+  }
+  std::sort(get.begin(), get.end());
+  _properties[0x9D] = encode({0x80, 0x88});
+  _properties[0x9E] = encode(set);
+  _properties[0x9F] = encode(get);
+}
@@ -0,0 +1,117 @@
+#ifndef BP35A1_EMULATOR_H_
+#define BP35A1_EMULATOR_H_
+
+#include "bp35a1_SerialPort.h"
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// エミュレータの動作設定。時間はすべて ms
+struct EmulatorConfig
+{
+  unsigned long commandDelay = 5;  // コマンドの応答(OK など)までの時間
+  unsigned long scanTime = 1000;   // SKSCAN 1 回分の時間
+  unsigned long joinTime = 2000;   // SKJOIN から EVENT 25 までの時間
+  unsigned long rtt = 1000;        // SKSENDTO から ERXUDP までの往復時間
+  unsigned long jitter = 0;        // rtt に加える 0 ~ jitter のゆらぎ
+  double loss = 0.0;               // ERXUDP が届かない確率
+  double sendFailure = 0.0;        // SKSENDTO が送信できない(EVENT 21 ステータス 01)確率
+  unsigned int scanMisses = 0;     // PAN が見つからない SKSCAN の回数
+  unsigned int neighbours = 0;     // スキャンで見つかる近隣の家の PAN の数(LQI は高いが Pairing ID が異なる)
+  bool binaryErxudp = false;       // WOPT 00 の状態で起動する
+  uint32_t seed = 1;               // 損失・ゆらぎの乱数の種
+
+  std::string channel = "21";
+  std::string panId = "8888";
+  std::string macAddress = "001D129012345678"; // スマートメーターの MAC アドレス
+  std::string lqi = "A0";
+};
+
+// BP35A1 と低圧スマート電力量メータ(0x028801)をまとめて模擬する SerialPort
+// BP35A1 クラスから見るとシリアルの先に BP35A1 がつながっているのと同じに振る舞う
+// 応答は書き込み時に予約され、時刻(millis())が来たものから読み出せるようになる
+class BP35A1Emulator final : public SerialPort
+{
+public:
+  // Get の EDT を動的に返す。false を返すと setProperty() した値(なければ Get_SNA)になる
+  typedef std::function<bool(byte epc, std::vector<byte> *edt)> PropertyHandler;
+
+  struct Stats
+  {
+    unsigned long commands = 0;  // 受け付けたコマンドの数
+    unsigned long requests = 0;  // SKSENDTO で受け取った ECHONET Lite 要求の数
+    unsigned long responses = 0; // 送った ERXUDP の数
+    unsigned long dropped = 0;   // 損失させた ERXUDP の数
+    unsigned long sendFailures = 0; // EVENT 21 ステータス 01 にした SKSENDTO の数
+    unsigned long reauthentications = 0; // モジュールが自分で始めた再認証(EVENT 29)の数
+    unsigned long rejoins = 0;           // SKREJOIN の数
+    unsigned long notifications = 0;     // 送った INF / INFC の数
+    unsigned long acknowledgements = 0;  // 受け取った INFC_Res の数
+  };
+
+  explicit BP35A1Emulator(const EmulatorConfig &config = EmulatorConfig());
+
+  int available() override;
+  int read() override;
+  size_t readBytes(char *buffer, size_t length) override;
+  size_t write(const byte *data, size_t size) override;
+  using SerialPort::write;
+
+  EmulatorConfig &config() { return _config; }
+  const Stats &getStats() const { return _stats; }
+
+  void setProperty(byte epc, const std::vector<byte> &edt); // Get で返す値を設定する
+  void removeProperty(byte epc);                            // 以降の Get は Get_SNA になる
+  void setSettable(byte epc, bool settable);                // SetC を受け付けるか
+  void setPropertyHandler(PropertyHandler handler) { _handler = handler; }
+  bool getProperty(byte epc, std::vector<byte> *edt) const;
+
+  void schedule(unsigned long delayMs, const std::string &line); // 任意の行を送る
+  void triggerReauthentication();                                 // EVENT 29 に続けて EVENT 25 を送る
+  void notify(const std::vector<byte> &epcs, bool confirmed);     // 現在の値を INF(confirmed なら INFC)で通知する
+  void failNextJoin() { _failNextJoin = true; }                   // 次の SKJOIN を EVENT 24 にする
+  bool isConnected() const { return _connected; }
+  std::string getIpv6Address() const; // スマートメーターのリンクローカルアドレス
+
+private:
+  struct Output
+  {
+    unsigned long time;
+    std::string data;
+  };
+
+  void pump();
+  void handleInput();
+  void handleCommand(const std::string &command);
+  void handleSendTo(const std::vector<std::string> &tokens, const std::string &data);
+  std::vector<byte> respond(const std::vector<byte> &request);
+  std::string erxudp(const std::vector<byte> &frame) const;
+  void reply(unsigned long delayMs, const std::string &line);
+  unsigned long random(unsigned long range);
+  void updatePropertyMaps();
+  void authenticate(); // SKJOIN / SKREJOIN / EVENT 29 で joinTime 後に認証が完了する
+
+  EmulatorConfig _config;
+  Stats _stats;
+  std::deque<char> _rx;        // BP35A1 クラスが読み出せるデータ
+  std::vector<Output> _output; // 送信予定のデータ(時刻順)
+  std::string _input;          // 受け取り中のコマンド
+  std::map<byte, std::vector<byte>> _properties;
+  std::map<byte, bool> _settable;
+  PropertyHandler _handler;
+  uint32_t _random;
+  unsigned int _scanCount = 0;
+  uint16_t _notificationTid = 0x8000; // 通知に使う TID
+  std::string _pairId = "00000001"; // SKSETRBID の ID の下位 8 文字
+  bool _failNextJoin = false;
+  unsigned long _sessionLifetime = 0; // SKSREG S16 で設定した PANA セッション有効期限(秒)。0 なら自動で再認証しない
+  unsigned long _authenticatedAt = 0; // 最後に認証が完了する時刻
+  unsigned long _reauthUntil = 0;     // 再認証中はこの時刻まで ERXUDP を送らない
+  bool _connected = false;
+  bool _binary = false;
+};
+
+#endif
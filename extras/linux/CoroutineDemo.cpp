@@ -0,0 +1,127 @@
+// 複数のスマートメーターをコルーチンで 1 つのイベントループ(epoll)から扱う
+// 使い方: CoroutineDemo <B ルート ID> <B ルートパスワード> [デバイス...]
+// デバイスを指定しなければエミュレータを 2 台使う
+
+#include "bp35a1_Coroutine.h"
+#include "bp35a1_Emulator.h"
+#include "bp35a1_LinuxSerialPort.h"
+
+#include <memory>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#ifdef BP35A1_HAS_COROUTINE
+
+// 実機(LinuxSerialPort)とエミュレータを実行時に選ぶので、共通の SerialPort で実体化する
+typedef CoBP35A1<SerialPort> Meter;
+
+CoTask<> runMeter(Meter &meter, int index, const char *id, const char *password)
+{
+  bool connected = co_await meter.connect(id, password);
+  if (!connected)
+  {
+    printf("meter %d: connect failed\n", index);
+    co_return;
+  }
+  printf("meter %d: connected\n", index);
+
+  // GCC 12.2 では co_await の引数に初期化子リストを書くと "array used as initializer" でコンパイルできないので変数にする
+  std::vector<CmdType> units = {CmdType::COEFFICIENT, CmdType::POWER_UNIT};
+  co_await meter.get(units);
+  for (int i = 0; i < 5; i++)
+  {
+    AsyncResult result = co_await meter.get(CmdType::INSTANTANEOUS_POWER);
+    if (result.status == CommandStatus::SUCCEEDED)
+    {
+      printf("meter %d: %d[W] (%lums)\n", index, meter.device()->getInstantaneousPower(), result.latency);
+    }
+    else
+    {
+      printf("meter %d: failed\n", index);
+    }
+    co_await meter.sleep(2000);
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc < 3)
+  {
+    printf("usage: %s <B route id> <B route password> [device...]\n", argv[0]);
+    return 1;
+  }
+
+  std::vector<std::unique_ptr<SerialPort>> ports;
+  int epoll = epoll_create1(EPOLL_CLOEXEC);
+  for (int i = 3; i < argc; i++)
+  {
+    std::unique_ptr<LinuxSerialPort> port(new LinuxSerialPort());
+    if (!port->open(argv[i]))
+    {
+      return 1;
+    }
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    epoll_ctl(epoll, EPOLL_CTL_ADD, port->getFd(), &event);
+    ports.push_back(std::move(port));
+  }
+  if (ports.empty())
+  {
+    for (uint32_t seed = 1; seed <= 2; seed++)
+    {
+      EmulatorConfig config;
+      config.scanTime = 200;
+      config.joinTime = 500;
+      config.rtt = 400 * seed;
+      config.jitter = 100;
+      config.seed = seed;
+      ports.push_back(std::unique_ptr<SerialPort>(new BP35A1Emulator(config)));
+    }
+  }
+
+  std::vector<std::unique_ptr<BP35A1>> devices;
+  std::vector<std::unique_ptr<Meter>> meters;
+  std::vector<CoTask<>> tasks;
+  for (size_t i = 0; i < ports.size(); i++)
+  {
+    devices.push_back(std::unique_ptr<BP35A1>(new BP35A1(ports[i].get())));
+    devices.back()->clearBuffer();
+    if (!devices.back()->assureAsciiMode())
+    {
+      printf("meter %zu: no response\n", i);
+      return 1;
+    }
+    meters.push_back(std::unique_ptr<Meter>(new Meter(devices.back().get())));
+    tasks.push_back(runMeter(*meters.back(), i, argv[1], argv[2]));
+    tasks.back().start();
+  }
+
+  // どのメーターも同じスレッドで進める。受信がなくてもタイマーのために 10ms ごとに起きる
+  for (;;)
+  {
+    bool done = true;
+    for (size_t i = 0; i < meters.size(); i++)
+    {
+      meters[i]->poll();
+      done = done && tasks[i].done();
+    }
+    if (done)
+    {
+      break;
+    }
+    epoll_event events[8];
+    epoll_wait(epoll, events, 8, 10);
+  }
+  close(epoll);
+  return 0;
+}
+
+#else
+
+int main()
+{
+  printf("C++20 coroutines are not available\n");
+  return 1;
+}
+
+#endif
@@ -0,0 +1,47 @@
+// Linux のシリアルデバイスにつないだ BP35A1 で瞬時電力を定期取得する
+// 使い方: LinuxSerialDemo <デバイス> <B ルート ID> <B ルートパスワード>
+// 実機がなければ PtyEmulator が表示したパスを <デバイス> に指定する
+
+#include "bp35a1.h"
+#include "bp35a1_LinuxSerialPort.h"
+
+int main(int argc, char *argv[])
+{
+  if (argc < 4)
+  {
+    printf("usage: %s <device> <B route id> <B route password>\n", argv[0]);
+    return 1;
+  }
+
+  LinuxSerialPort port;
+  if (!port.open(argv[1], 115200))
+  {
+    return 1;
+  }
+  BasicBP35A1<LinuxSerialPort> bp35a1(&port); // LinuxSerialPort を直接呼び出す
+
+  bp35a1.clearBuffer();
+  bp35a1.deleteSession();
+  if (!bp35a1.assureAsciiMode() || !bp35a1.setPassword(argv[3]) || !bp35a1.setId(argv[2]) ||
+      !bp35a1.scanChannel() || !bp35a1.getIpv6Address() || !bp35a1.setChannel() || !bp35a1.setPanId() ||
+      !bp35a1.requestAndWaitConnection())
+  {
+    printf("connect failed\n");
+    return 1;
+  }
+  printf("connected\n");
+  bp35a1.getProperties({CmdType::COEFFICIENT, CmdType::POWER_UNIT});
+
+  bp35a1.setPollCallback([&](CmdType command, CommandStatus status)
+                         {
+                           if (command == CmdType::INSTANTANEOUS_POWER && status == CommandStatus::SUCCEEDED)
+                             printf("%lu: %d[W]\n", millis(), bp35a1.getInstantaneousPower());
+                         });
+  bp35a1.addPollProperty(CmdType::INSTANTANEOUS_POWER, 10000);
+
+  while (true)
+  {
+    bp35a1.poll();
+    port.waitForData(100);
+  }
+}